@@ -1,7 +1,7 @@
-#include <unistd.h>                 // sleep(), usleep().
-#include <ctime>                    // time().
+#include <unistd.h>                 // sleep().
 #include <iostream>                 // std::cout, std::cerr, std::endl.
 #include <string>                   // std::string.
+#include <string_view>              // std::string_view.
 
 #include "satellite_terminal.h"
 
@@ -11,21 +11,16 @@ int main(int argc, char *argv[]) {
 
 	if (stc.IsConnected()) {
 		
-		while (stc.GetErrorCode().err_no == 0) {
-			
-			std::string inbound_message = stc.GetMessage();
-			
-			if (inbound_message != "") {
-				std::cout << inbound_message << std::endl;
-				if (inbound_message != stc.GetStopMessage()) {
-					stc.SendMessage(inbound_message);
-				} else {
-					break;
-				}
-				
+		stc.OnMessage(stc.GetPortIdentifiers()[0], [&stc](std::string_view inbound_message) {
+			std::cout << inbound_message << std::endl;
+			if (inbound_message != stc.GetStopMessage()) {
+				stc.SendMessage(std::string(inbound_message));
+			} else {
+				stc.Stop();
 			}
-			usleep(1000);
-		}
+		});
+		stc.Run();
+		
 		std::cerr << "On termination error code = " << stc.GetErrorCode().err_no << "    Error detail = " << stc.GetErrorCode().err_detail << std::endl;
 		sleep(20);        // Delay to read the message before terminal emulator window closes.
 	} else {
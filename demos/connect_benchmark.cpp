@@ -0,0 +1,70 @@
+#include <iostream>                 // std::cout, std::cerr, std::endl.
+#include <string>                   // std::string, std::to_string.
+#include <vector>                   // std::vector.
+#include <algorithm>                // std::sort.
+#include <chrono>                   // std::chrono::steady_clock, std::chrono::microseconds.
+
+#include "satellite_terminal.h"
+
+// Measures connection setup, from constructing a headless SatTerm_Server to its constructor returning connected, for each transport and
+// for increasing numbers of Ports. The same binary is started as the client, which disconnects as soon as it is told to stop.
+
+static const size_t ITERATIONS = 50;
+
+int RunClient(int argc, char* argv[]) {
+	SatTerm_Client stc("benchmark_client", argc, argv, false);
+	if (!stc.IsConnected()) {
+		return 1;
+	}
+	while (stc.IsConnected() && (stc.GetMessage(false, std::chrono::seconds(5)) != stc.GetStopMessage())) {}    // The server stops the default Port.
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	for (int i = 1; i < argc; i ++) {
+		if (std::string(argv[i]) == "client_args") {
+			return RunClient(argc, argv);
+		}
+	}
+
+	std::vector<std::pair<transport_mode, std::string>> transports = {{transport_mode::fifo, "fifo"},
+	                                                                  {transport_mode::shared_memory, "shared_memory"},
+	                                                                  {transport_mode::seqpacket, "seqpacket"}};
+	std::cout << "transport        ports   median_us   mean_us" << std::endl;
+	for (auto const& transport : transports) {
+		for (size_t port_count : {1, 4, 16}) {
+			std::vector<std::string> port_identifiers = {};
+			for (size_t i = 0; i < port_count; i ++) {
+				port_identifiers.push_back("bench_" + std::to_string(i));
+			}
+			port_options options;
+			options.transport = transport.first;
+			launch_options launch;
+			launch.mode = launch_mode::headless;
+
+			std::vector<long> times = {};
+			for (size_t i = 0; i < ITERATIONS; i ++) {
+				std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+				{
+					SatTerm_Server sts("benchmark_server", argv[0], false, port_identifiers, "q", "./terminal_emulator_paths.txt", 3, "",
+					                   std::chrono::seconds(5), options, launch);
+					std::chrono::steady_clock::time_point end_time = std::chrono::steady_clock::now();
+					if (!sts.IsConnected()) {
+						std::cerr << "Connection failed, error detail = " << sts.GetErrorCode().err_detail << std::endl;
+						return 1;
+					}
+					times.push_back((long)(std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count()));
+				}                                                   // The server waits for its client to exit.
+			}
+
+			std::sort(times.begin(), times.end());
+			long total = 0;
+			for (long time : times) {
+				total += time;
+			}
+			std::string name = transport.second + std::string(17 - transport.second.size(), ' ');
+			std::cout << name << port_count << "\t" << times[times.size() / 2] << "\t" << (total / (long)(times.size())) << std::endl;
+		}
+	}
+	return 0;
+}
@@ -1,7 +1,7 @@
-#include <unistd.h>                 // sleep(), usleep().
-#include <ctime>                    // time().
 #include <iostream>                 // std::cout, std::cerr, std::endl.
 #include <string>                   // std::string.
+#include <string_view>              // std::string_view.
+#include <chrono>                   // std::chrono::seconds.
 
 #include "satellite_terminal.h"
 
@@ -16,17 +16,11 @@ int main (void) {
 			sts.SendMessage(outbound_message);
 		}
 		
-		unsigned long timeout_seconds = 5;
-		unsigned long start_time = time(0);
-		
-		while ((sts.GetErrorCode().err_no == 0) && ((time(0) - start_time) < timeout_seconds)) {
-			std::string inbound_message = sts.GetMessage();
-			if (inbound_message != "") {
-				std::cout << "Message \"" << inbound_message << "\" returned by client." << std::endl;
-			}
-			usleep(1000);
-		}
-		
+		sts.OnMessage(sts.GetPortIdentifiers()[0], [](std::string_view inbound_message) {
+			std::cout << "Message \"" << inbound_message << "\" returned by client." << std::endl;
+		});
+		sts.RunFor(std::chrono::seconds(5));
+
 		std::cerr << "On termination error code = " << sts.GetErrorCode().err_no << "    Error detail = " << sts.GetErrorCode().err_detail << std::endl;
 		
 	} else {
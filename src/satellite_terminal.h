@@ -11,11 +11,25 @@
 // -----------------------------------------------------------------------------------------------------
 
 #include <string>                    // std::string.
+#include <string_view>               // std::string_view.
 #include <vector>                    // std::vector.
 #include <map>                       // std::map.
 #include <memory>                    // std::unique_ptr.
+#include <atomic>                    // std::atomic.
+#include <thread>                    // std::thread.
+#include <functional>                // std::function.
+#include <deque>                     // std::deque.
 
 #include "satterm_port.h"
+#include "satterm_queue.h"
+#if defined(__cpp_impl_coroutine)
+#include "satterm_async.h"
+#endif
+
+typedef std::function<void(std::string_view message)> satterm_message_handler;
+typedef std::function<void(std::string const& port_identifier, error_descriptor const& error)> satterm_disconnect_handler;
+typedef std::function<void(size_t client, port_handle port, std::string_view message)> satterm_pool_message_handler;
+typedef std::function<void(size_t client, std::string const& port_identifier, error_descriptor const& error)> satterm_pool_disconnect_handler;
 
 class SatTerm_Agent {
 	public:
@@ -23,32 +37,211 @@ class SatTerm_Agent {
 		virtual ~SatTerm_Agent();
 		
 		std::string GetMessage(bool capture_end_char = false, unsigned long timeout_seconds = 0);
+		std::string GetMessage(bool capture_end_char, satterm_duration timeout);
+		std::string GetMessage(bool capture_end_char, satterm_deadline deadline);
 		std::string GetMessage(std::string const& port_identifier, bool capture_end_char = false, unsigned long timeout_seconds = 0);
+		std::string GetMessage(std::string const& port_identifier, bool capture_end_char, satterm_duration timeout);
+		std::string GetMessage(std::string const& port_identifier, bool capture_end_char, satterm_deadline deadline);
+		std::string GetMessage(port_handle port, bool capture_end_char = false, unsigned long timeout_seconds = 0);
+		std::string GetMessage(port_handle port, bool capture_end_char, satterm_duration timeout);
+		std::string GetMessage(port_handle port, bool capture_end_char, satterm_deadline deadline);
+		std::string_view GetMessageView(bool capture_end_char = false, unsigned long timeout_seconds = 0);
+		std::string_view GetMessageView(bool capture_end_char, satterm_duration timeout);
+		std::string_view GetMessageView(bool capture_end_char, satterm_deadline deadline);
+		std::string_view GetMessageView(std::string const& port_identifier, bool capture_end_char = false, unsigned long timeout_seconds = 0);
+		std::string_view GetMessageView(std::string const& port_identifier, bool capture_end_char, satterm_duration timeout);
+		std::string_view GetMessageView(std::string const& port_identifier, bool capture_end_char, satterm_deadline deadline);
+		std::string_view GetMessageView(port_handle port, bool capture_end_char = false, unsigned long timeout_seconds = 0);
+		std::string_view GetMessageView(port_handle port, bool capture_end_char, satterm_duration timeout);
+		std::string_view GetMessageView(port_handle port, bool capture_end_char, satterm_deadline deadline);
+		size_t GetMessages(std::vector<std::string>& messages, size_t max_count, bool capture_end_char = false, unsigned long timeout_seconds = 0);
+		size_t GetMessages(std::vector<std::string>& messages, size_t max_count, bool capture_end_char, satterm_duration timeout);
+		size_t GetMessages(std::vector<std::string>& messages, size_t max_count, bool capture_end_char, satterm_deadline deadline);
+		size_t GetMessages(std::string const& port_identifier, std::vector<std::string>& messages, size_t max_count,
+		                   bool capture_end_char = false, unsigned long timeout_seconds = 0);
+		size_t GetMessages(std::string const& port_identifier, std::vector<std::string>& messages, size_t max_count,
+		                   bool capture_end_char, satterm_duration timeout);
+		size_t GetMessages(std::string const& port_identifier, std::vector<std::string>& messages, size_t max_count,
+		                   bool capture_end_char, satterm_deadline deadline);
+		size_t GetMessages(port_handle port, std::vector<std::string>& messages, size_t max_count,
+		                   bool capture_end_char = false, unsigned long timeout_seconds = 0);
+		size_t GetMessages(port_handle port, std::vector<std::string>& messages, size_t max_count,
+		                   bool capture_end_char, satterm_duration timeout);
+		size_t GetMessages(port_handle port, std::vector<std::string>& messages, size_t max_count,
+		                   bool capture_end_char, satterm_deadline deadline);
+		size_t ReceiveBulk(int descriptor, unsigned long timeout_seconds = 0);
+		size_t ReceiveBulk(int descriptor, satterm_duration timeout);
+		size_t ReceiveBulk(int descriptor, satterm_deadline deadline);
+		size_t ReceiveBulk(std::string const& port_identifier, int descriptor, unsigned long timeout_seconds = 0);
+		size_t ReceiveBulk(std::string const& port_identifier, int descriptor, satterm_duration timeout);
+		size_t ReceiveBulk(std::string const& port_identifier, int descriptor, satterm_deadline deadline);
+		size_t ReceiveBulk(port_handle port, int descriptor, unsigned long timeout_seconds = 0);
+		size_t ReceiveBulk(port_handle port, int descriptor, satterm_duration timeout);
+		size_t ReceiveBulk(port_handle port, int descriptor, satterm_deadline deadline);
 		std::string SendMessage(std::string const& message, unsigned long timeout_seconds = 0);
+		std::string SendMessage(std::string const& message, satterm_duration timeout);
+		std::string SendMessage(std::string const& message, satterm_deadline deadline);
 		std::string SendMessage(std::string const& message, std::string const& port_identifier, unsigned long timeout_seconds = 5);
+		std::string SendMessage(std::string const& message, std::string const& port_identifier, satterm_duration timeout);
+		std::string SendMessage(std::string const& message, std::string const& port_identifier, satterm_deadline deadline);
+		std::string SendMessage(std::string const& message, port_handle port, unsigned long timeout_seconds = 5);
+		std::string SendMessage(std::string const& message, port_handle port, satterm_duration timeout);
+		std::string SendMessage(std::string const& message, port_handle port, satterm_deadline deadline);
+		size_t SendMessage(std::vector<std::string_view> const& message_parts, unsigned long timeout_seconds = 0);
+		size_t SendMessage(std::vector<std::string_view> const& message_parts, satterm_duration timeout);
+		size_t SendMessage(std::vector<std::string_view> const& message_parts, satterm_deadline deadline);
+		size_t SendMessage(std::vector<std::string_view> const& message_parts, std::string const& port_identifier, unsigned long timeout_seconds = 5);
+		size_t SendMessage(std::vector<std::string_view> const& message_parts, std::string const& port_identifier, satterm_duration timeout);
+		size_t SendMessage(std::vector<std::string_view> const& message_parts, std::string const& port_identifier, satterm_deadline deadline);
+		size_t SendMessage(std::vector<std::string_view> const& message_parts, port_handle port, unsigned long timeout_seconds = 5);
+		size_t SendMessage(std::vector<std::string_view> const& message_parts, port_handle port, satterm_duration timeout);
+		size_t SendMessage(std::vector<std::string_view> const& message_parts, port_handle port, satterm_deadline deadline);
+		size_t SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, unsigned long timeout_seconds = 0);
+		size_t SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, satterm_duration timeout);
+		size_t SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, satterm_deadline deadline);
+		size_t SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, std::string const& port_identifier,
+		                    unsigned long timeout_seconds = 5);
+		size_t SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, std::string const& port_identifier,
+		                    satterm_duration timeout);
+		size_t SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, std::string const& port_identifier,
+		                    satterm_deadline deadline);
+		size_t SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, port_handle port,
+		                    unsigned long timeout_seconds = 5);
+		size_t SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, port_handle port,
+		                    satterm_duration timeout);
+		size_t SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, port_handle port,
+		                    satterm_deadline deadline);
 		size_t SendBytes(const char* bytes, size_t byte_count, unsigned long timeout_seconds = 5);
+		size_t SendBytes(const char* bytes, size_t byte_count, satterm_duration timeout);
+		size_t SendBytes(const char* bytes, size_t byte_count, satterm_deadline deadline);
 		size_t SendBytes(const char* bytes, size_t byte_count, std::string const& port_identifier, unsigned long timeout_seconds = 5);
+		size_t SendBytes(const char* bytes, size_t byte_count, std::string const& port_identifier, satterm_duration timeout);
+		size_t SendBytes(const char* bytes, size_t byte_count, std::string const& port_identifier, satterm_deadline deadline);
+		size_t SendBytes(const char* bytes, size_t byte_count, port_handle port, unsigned long timeout_seconds = 5);
+		size_t SendBytes(const char* bytes, size_t byte_count, port_handle port, satterm_duration timeout);
+		size_t SendBytes(const char* bytes, size_t byte_count, port_handle port, satterm_deadline deadline);
+		size_t SendBulk(const char* bytes, size_t byte_count, unsigned long timeout_seconds = 5);
+		size_t SendBulk(const char* bytes, size_t byte_count, satterm_duration timeout);
+		size_t SendBulk(const char* bytes, size_t byte_count, satterm_deadline deadline);
+		size_t SendBulk(const char* bytes, size_t byte_count, std::string const& port_identifier, unsigned long timeout_seconds = 5);
+		size_t SendBulk(const char* bytes, size_t byte_count, std::string const& port_identifier, satterm_duration timeout);
+		size_t SendBulk(const char* bytes, size_t byte_count, std::string const& port_identifier, satterm_deadline deadline);
+		size_t SendBulk(const char* bytes, size_t byte_count, port_handle port, unsigned long timeout_seconds = 5);
+		size_t SendBulk(const char* bytes, size_t byte_count, port_handle port, satterm_duration timeout);
+		size_t SendBulk(const char* bytes, size_t byte_count, port_handle port, satterm_deadline deadline);
+		bool FlushTx(unsigned long timeout_seconds = 0);
+		bool FlushTx(satterm_duration timeout);
+		bool FlushTx(satterm_deadline deadline);
+		bool FlushTx(std::string const& port_identifier, unsigned long timeout_seconds = 0);
+		bool FlushTx(std::string const& port_identifier, satterm_duration timeout);
+		bool FlushTx(std::string const& port_identifier, satterm_deadline deadline);
+		bool FlushTx(port_handle port, unsigned long timeout_seconds = 0);
+		bool FlushTx(port_handle port, satterm_duration timeout);
+		bool FlushTx(port_handle port, satterm_deadline deadline);
+		
+		std::vector<std::string> GetReadyPorts(unsigned long timeout_seconds = 0, bool writable = false);
+		std::vector<std::string> GetReadyPorts(satterm_duration timeout, bool writable = false);
+		std::vector<std::string> GetReadyPorts(satterm_deadline deadline, bool writable = false);
+		size_t GetReadyPorts(std::vector<port_handle>& ready_ports, unsigned long timeout_seconds = 0, bool writable = false);
+		size_t GetReadyPorts(std::vector<port_handle>& ready_ports, satterm_duration timeout, bool writable = false);
+		size_t GetReadyPorts(std::vector<port_handle>& ready_ports, satterm_deadline deadline, bool writable = false);
 		
 		error_descriptor GetErrorCode(void);
+		error_state GetErrorState(void);
 		std::string GetStopPortIdentifier(void);
 		std::string GetStopMessage(void);
 		std::vector<std::string> GetPortIdentifiers(void);
+		port_handle GetPortHandle(std::string const& port_identifier);
+		std::string GetPortIdentifier(port_handle port);
+		size_t GetPipeSize(std::string const& port_identifier, bool writable = true);
+		size_t GetPipeSize(port_handle port, bool writable = true);
+		size_t GetUnreadBytes(std::string const& port_identifier);
+		size_t GetUnreadBytes(port_handle port);
 		bool IsConnected(void);
 		void SetConnectedFlag(bool is_connected);
 		
+		void OnMessage(std::string const& port_identifier, satterm_message_handler handler);
+		void OnMessage(port_handle port, satterm_message_handler handler);
+		void OnDisconnect(satterm_disconnect_handler handler);
+		size_t Run(void);
+		size_t RunFor(satterm_duration duration);
+		size_t RunUntil(satterm_deadline deadline);
+		void Stop(void);
+		
+		bool StartIoThread(size_t queue_capacity = 1024);
+		void StopIoThread(void);
+		bool IsIoThreadRunning(void);
+		
+#if defined(__cpp_impl_coroutine)
+		satterm_receive_operation ReceiveAsync(bool capture_end_char = false, satterm_duration timeout = satterm_duration::max());
+		satterm_receive_operation ReceiveAsync(bool capture_end_char, satterm_deadline deadline);
+		satterm_receive_operation ReceiveAsync(std::string const& port_identifier, bool capture_end_char = false,
+		                                       satterm_duration timeout = satterm_duration::max());
+		satterm_receive_operation ReceiveAsync(std::string const& port_identifier, bool capture_end_char, satterm_deadline deadline);
+		satterm_receive_operation ReceiveAsync(port_handle port, bool capture_end_char = false, satterm_duration timeout = satterm_duration::max());
+		satterm_receive_operation ReceiveAsync(port_handle port, bool capture_end_char, satterm_deadline deadline);
+		satterm_send_operation SendAsync(std::string const& message, satterm_duration timeout = satterm_duration::max());
+		satterm_send_operation SendAsync(std::string const& message, satterm_deadline deadline);
+		satterm_send_operation SendAsync(std::string const& message, std::string const& port_identifier, satterm_duration timeout = satterm_duration::max());
+		satterm_send_operation SendAsync(std::string const& message, std::string const& port_identifier, satterm_deadline deadline);
+		satterm_send_operation SendAsync(std::string const& message, port_handle port, satterm_duration timeout = satterm_duration::max());
+		satterm_send_operation SendAsync(std::string const& message, port_handle port, satterm_deadline deadline);
+		
+#endif
 	protected:
 		bool CreatePorts(bool is_server, std::string const& working_path, std::vector<std::string> port_identifiers,
-		                 bool display_messages, char end_char, std::map<std::string, std::unique_ptr<Port>>& ports);
-		error_descriptor m_error_code = {0, ""};
+		                 bool display_messages, char end_char, port_options const& options, std::vector<std::unique_ptr<Port>>& ports);
+		void ClosePorts(void);
+		bool OpenSession(bool is_server, satterm_deadline deadline, port_options const& options);
+		bool AcceptSession(port_options const& options, satterm_deadline deadline);
+		bool RequestSession(satterm_deadline deadline);
+		static std::vector<std::string> SplitSessionMessage(std::string const& message, char separator);
+		bool FindPort(std::string const& port_identifier, const char* caller, port_handle& port);
+		Port* GetPort(port_handle port, const char* caller);
+		int GetReadinessDescriptor(bool writable);
+		int GetPortDescriptor(port_handle port, bool writable);
+		void RunIoThread(void);
+		bool ServiceIoPort(size_t port_index, satterm_deadline tx_deadline);
+		void FailIoPort(io_port& io, error_state const& error);
+		bool ReceiveQueuedMessage(port_handle port, bool capture_end_char, satterm_deadline deadline);
+		bool SendQueuedMessage(port_handle port, std::string_view const* message_parts, size_t part_count, bool raw_bytes,
+		                       satterm_deadline deadline);
+		size_t GetQueuedReadyPorts(std::vector<port_handle>& ready_ports, satterm_deadline deadline, bool writable);
+		void WaitForIoThread(uint32_t wake_sequence, satterm_deadline deadline);
+		void RingEvent(int event_descriptor);
+		SatTerm_ErrorCell m_error;
+		std::string m_error_context = "";                           // Backs m_error.context when it is not a string literal.
 		bool m_display_messages = false;
-		std::map<std::string, std::unique_ptr<Port>> m_ports = {};
+		std::vector<std::unique_ptr<Port>> m_ports = {};
+		std::map<std::string, size_t> m_port_indices = {};
+		std::unique_ptr<Port> m_session_port = nullptr;             // Only exists until OpenSession() has finished.
+		port_handle m_default_port = {0};                            // The default Port is always the first one created.
 		std::string m_default_port_identifier = "";
 		std::string m_stop_port_identifier = "";
 		std::string m_working_path = "";
 		std::string m_identifier = "";
 		std::string m_stop_message = "";
 		char m_end_char = 0;
-		bool m_connected = false;
+		std::atomic<bool> m_connected = {false};
+		int m_rx_epoll_descriptor = -1;
+		int m_tx_epoll_descriptor = -1;
+		std::vector<satterm_message_handler> m_message_handlers = {};
+		satterm_disconnect_handler m_disconnect_handler = nullptr;
+		bool m_reactor_stop = false;
+		std::vector<std::unique_ptr<io_port>> m_io_ports = {};
+		std::thread m_io_thread = {};
+		bool m_io_running = false;
+		std::atomic<bool> m_io_stop = {false};
+		std::atomic<bool> m_io_waiting = {false};                   // The I/O thread is (about to be) asleep in poll().
+		std::atomic<int> m_app_waiting = {0};                        // Number of application threads (about to be) asleep.
+		std::atomic<uint32_t> m_app_wake_sequence = {0};             // Futex word the I/O thread bumps to wake every application thread.
+		int m_io_event_descriptor = -1;                              // eventfd that wakes the I/O thread.
+		
+		friend class SatTerm_Pool;
+#if defined(__cpp_impl_coroutine)
+		friend struct satterm_receive_operation;
+		friend struct satterm_send_operation;
+#endif
 };
 
 class SatTerm_Server : public SatTerm_Agent {
@@ -56,14 +249,48 @@ class SatTerm_Server : public SatTerm_Agent {
 		SatTerm_Server(std::string const& identifier, std::string const& path_to_client_binary, bool display_messages = true,
 		               std::vector<std::string> port_identifiers = {"comms"}, std::string const& stop_message = "q",
 		               std::string const& path_to_terminal_emulator_paths = "./terminal_emulator_paths.txt",
-		               char end_char = 3, std::string const& stop_port_identifier = "", unsigned long timeout_seconds = 5);
+		               char end_char = 3, std::string const& stop_port_identifier = "", unsigned long timeout_seconds = 5,
+		               port_options const& options = port_options(), launch_options const& launch = launch_options());
+		SatTerm_Server(std::string const& identifier, std::string const& path_to_client_binary, bool display_messages,
+		               std::vector<std::string> port_identifiers, std::string const& stop_message,
+		               std::string const& path_to_terminal_emulator_paths,
+		               char end_char, std::string const& stop_port_identifier, satterm_duration timeout,
+		               port_options const& options = port_options(), launch_options const& launch = launch_options());
 		~SatTerm_Server();
+		
+		pid_t GetClientPid(void);
+		
+#if defined(__cpp_impl_coroutine)
+		static satterm_connect_operation ConnectAsync(std::string const& identifier, std::string const& path_to_client_binary, bool display_messages = true,
+		                                              std::vector<std::string> port_identifiers = {"comms"}, std::string const& stop_message = "q",
+		                                              std::string const& path_to_terminal_emulator_paths = "./terminal_emulator_paths.txt",
+		                                              char end_char = 3, std::string const& stop_port_identifier = "",
+		                                              satterm_duration timeout = std::chrono::seconds(5), port_options const& options = port_options(),
+		                                              launch_options const& launch = launch_options());
+#endif
 	
 	private:
+		SatTerm_Server() {}                                         // For SatTerm_Pool, which launches and connects its clients in stages.
+		bool Launch(std::string const& identifier, std::string const& path_to_client_binary, bool display_messages,
+		            std::vector<std::string> port_identifiers, std::string const& stop_message,
+		            std::string const& path_to_terminal_emulator_paths, char end_char, std::string const& stop_port_identifier,
+		            satterm_duration timeout, port_options const& options, launch_options const& launch);
+		void FinishConnecting(bool success);
+		void ReapClient(satterm_deadline deadline);
 		std::string GetWorkingPath(void);
 		std::vector<std::string> LoadTerminalEmulatorPaths(std::string const& file_path);
 		pid_t StartClient(std::string const& path_to_terminal_emulator_paths, std::string const& path_to_client_binary, std::string const& working_path,
-		                  char end_char, std::string const& stop_message, std::vector<std::string> port_identifiers);
+		                  char end_char, std::string const& stop_message, std::vector<std::string> port_identifiers, transport_mode transport,
+		                  satterm_duration timeout, launch_options const& launch);
+		std::string FindTerminalEmulator(std::string const& path_to_terminal_emulator_paths);
+		
+		// How long the client process is given to exit, once its Ports are closed, before it is killed.
+		static constexpr satterm_duration CLIENT_EXIT_WAIT = std::chrono::seconds(2);
+		
+		pid_t m_client_pid = -1;
+		bool m_client_reaped = false;
+		
+		friend class SatTerm_Pool;
 };
 
 class SatTerm_Client : public SatTerm_Agent {
@@ -76,3 +303,93 @@ class SatTerm_Client : public SatTerm_Agent {
 		std::vector<std::string> ParseFifoPaths(size_t argv_start_index, size_t argv_count, char* argv[]);
 		
 };
+
+class SatTerm_Pool {
+	public:
+		SatTerm_Pool(std::string const& identifier, std::string const& path_to_client_binary, size_t client_count, bool display_messages = true,
+		             std::vector<std::string> port_identifiers = {"comms"}, std::string const& stop_message = "q",
+		             std::string const& path_to_terminal_emulator_paths = "./terminal_emulator_paths.txt", char end_char = 3,
+		             satterm_duration timeout = std::chrono::seconds(5), port_options const& options = port_options(),
+		             launch_options const& launch = launch_options());
+		~SatTerm_Pool();
+		
+		size_t GetClientCount(void);
+		size_t GetConnectedCount(void);
+		SatTerm_Server* GetClient(size_t client);
+		
+		size_t GetReadyPorts(std::vector<pool_port>& ready_ports, unsigned long timeout_seconds = 0);
+		size_t GetReadyPorts(std::vector<pool_port>& ready_ports, satterm_duration timeout);
+		size_t GetReadyPorts(std::vector<pool_port>& ready_ports, satterm_deadline deadline);
+		size_t GetReadyPorts(std::vector<pool_port>& ready_ports, port_handle port, unsigned long timeout_seconds = 0);
+		size_t GetReadyPorts(std::vector<pool_port>& ready_ports, port_handle port, satterm_duration timeout);
+		size_t GetReadyPorts(std::vector<pool_port>& ready_ports, port_handle port, satterm_deadline deadline);
+		
+		void OnMessage(satterm_pool_message_handler handler);
+		void OnDisconnect(satterm_pool_disconnect_handler handler);
+		size_t Run(void);
+		size_t RunFor(satterm_duration duration);
+		size_t RunUntil(satterm_deadline deadline);
+		void Stop(void);
+		
+		error_descriptor GetErrorCode(void);
+		error_state GetErrorState(void);
+		
+	protected:
+		void AcceptSessions(std::vector<size_t> const& launched, port_options const& options, satterm_deadline deadline);
+		void StopClients(satterm_deadline deadline);
+		bool ReceiveStopConfirmation(SatTerm_Server& client, port_handle stop_port, std::vector<std::string>& messages);
+		int GetReadinessDescriptor(void);
+		int CreateReadinessDescriptor(size_t first_port, size_t end_port);
+		size_t WaitForReadyPorts(std::vector<pool_port>& ready_ports, int epoll_descriptor, size_t first_port, size_t end_port,
+		                         satterm_deadline deadline);
+		
+		SatTerm_ErrorCell m_error;
+		std::string m_identifier = "";
+		bool m_display_messages = false;
+		std::vector<std::unique_ptr<SatTerm_Server>> m_clients = {};
+		std::vector<std::string> m_port_identifiers = {};
+		std::vector<std::string> m_fifo_directories = {};            // Created by the pool, one per client, and removed with it.
+		int m_epoll_descriptor = -1;
+		std::vector<int> m_port_epoll_descriptors = {};              // Per Port index, for GetReadyPorts() on a single Port.
+		satterm_pool_message_handler m_message_handler = nullptr;
+		satterm_pool_disconnect_handler m_disconnect_handler = nullptr;
+		bool m_reactor_stop = false;
+};
+
+class SatTerm_Dispatcher {
+	public:
+		SatTerm_Dispatcher(SatTerm_Pool& pool, std::string const& port_identifier = "comms",
+		                   dispatch_policy policy = dispatch_policy::least_outstanding);
+		
+		void SetPolicy(dispatch_policy policy);
+		dispatch_policy GetPolicy(void);
+		
+		uint64_t Submit(std::string const& work_item, unsigned long timeout_seconds = 5);
+		uint64_t Submit(std::string const& work_item, satterm_duration timeout);
+		uint64_t Submit(std::string const& work_item, satterm_deadline deadline);
+		size_t GetResults(std::vector<dispatch_result>& results, size_t max_count = 0, unsigned long timeout_seconds = 0);
+		size_t GetResults(std::vector<dispatch_result>& results, size_t max_count, satterm_duration timeout);
+		size_t GetResults(std::vector<dispatch_result>& results, size_t max_count, satterm_deadline deadline);
+		size_t GetOutstandingCount(void);
+		size_t GetOutstandingCount(size_t client);
+		
+		error_descriptor GetErrorCode(void);
+		error_state GetErrorState(void);
+		
+	protected:
+		size_t SelectClient(void);
+		bool SendOwed(size_t client, satterm_deadline deadline);
+		void AbandonJobs(size_t client, std::vector<dispatch_result>& results);
+		
+		SatTerm_ErrorCell m_error;
+		SatTerm_Pool& m_pool;
+		port_handle m_port = {0};
+		bool m_port_valid = false;                                  // The connected clients all have the named Port, at m_port.
+		dispatch_policy m_policy = dispatch_policy::least_outstanding;
+		std::vector<std::deque<uint64_t>> m_outstanding = {};       // Per client, the jobs sent to it in order, awaiting their results.
+		std::vector<std::string> m_owed = {};                      // Per client, the unsent rest of a part-sent work item.
+		size_t m_next_client = 0;                                   // Where the next search for a client starts, so ties are shared out.
+		uint64_t m_next_job = 1;
+		std::vector<pool_port> m_ready_ports = {};
+		std::vector<std::string> m_messages = {};
+};
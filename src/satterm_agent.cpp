@@ -11,112 +11,1039 @@
 // -----------------------------------------------------------------------------------------------------
 
 #include <iostream>                   // std::cout, std::cerr, std::endl.
-#include <stdexcept>                  // std::out_of_range.
 #include <string>                     // std::string, std::to_string.
+#include <string_view>                // std::string_view.
 #include <map>                        // std::map.
 #include <vector>                     // std::vector.
 #include <memory>                     // std::unique_ptr.
+#include <algorithm>                  // std::find.
+#include <chrono>                     // std::chrono::ceil.
+
+#include <errno.h>                    // errno.
+#include <unistd.h>                   // close().
+#include <sys/epoll.h>                // epoll_create1(), epoll_ctl(), epoll_wait().
 
 #include "satellite_terminal.h"
 
+// Session handshake. The client's hello is SESSION_MAGIC, SESSION_VERSION, its capabilities (comma separated) and the identifiers of its
+// Ports in order. The server's welcome is SESSION_MAGIC, SESSION_VERSION, the framing mode, and for each Port in order the name of its
+// shared memory segment, or SESSION_NONE. Fields are separated by spaces, which Port identifiers cannot contain as they are passed to the
+// client on its command line.
+static const std::string SESSION_PORT_SUFFIX = "_session";
+static const std::string SESSION_MAGIC = "satterm_session";
+static const unsigned int SESSION_VERSION = 1;
+static const std::string SESSION_END_CHAR = "end_char";
+static const std::string SESSION_LENGTH_PREFIX = "length_prefix";
+static const std::string SESSION_SHARED_MEMORY = "shared_memory";
+static const std::string SESSION_SEQPACKET = "seqpacket";
+static const std::string SESSION_CAPABILITIES = SESSION_LENGTH_PREFIX + "," + SESSION_SHARED_MEMORY + "," + SESSION_SEQPACKET;
+static const std::string SESSION_NONE = "-";
+
 SatTerm_Agent::~SatTerm_Agent() {
+	ClosePorts();
+	if (m_io_event_descriptor >= 0) {
+		close(m_io_event_descriptor);
+	}
+	if (m_rx_epoll_descriptor >= 0) {
+		close(m_rx_epoll_descriptor);
+	}
+	if (m_tx_epoll_descriptor >= 0) {
+		close(m_tx_epoll_descriptor);
+	}
+}
+
+void SatTerm_Agent::ClosePorts(void) {
+	StopIoThread();
+	
 	// NOTE - STL containers apart from std::array make no guarantees about order of element destruction.
 	//
 	// If we want to destroy all the Ports 'in order' at each end, we need to force the issue rather than relying on the automatic behaviour.
-	std::map<std::string, std::unique_ptr<Port>>::iterator itr = m_ports.begin();
-	while (itr != m_ports.end()) {
-		itr = m_ports.erase(itr);
+	for (auto& port : m_ports) {
+		port.reset();
 	}
+	m_ports.clear();
 }
 
 bool SatTerm_Agent::CreatePorts(bool is_server, std::string const& working_path, std::vector<std::string> port_identifiers,
-                                bool display_messages, char end_char, std::map<std::string, std::unique_ptr<Port>>& ports) {
-	bool success = true;
+                                bool display_messages, char end_char, port_options const& options,
+                                std::vector<std::unique_ptr<Port>>& ports) {
+	// Ports are stored in the order given, so that the Port with handle index i is port_identifiers[i] (less any repeats) at both ends.
+	// Constructing them does all of the opening that needs nothing from the counterpart (see Port::StartOpen()), and OpenSession()
+	// completes it. The session Port, named after the default Port, carries the session handshake. It is always a pair of fifos with
+	// length-prefixed framing, whatever the options, as the hello and welcome may contain any byte that could be the end char.
+	std::string session_identifier = port_identifiers[0] + SESSION_PORT_SUFFIX;
+	if (std::find(port_identifiers.begin(), port_identifiers.end(), session_identifier) != port_identifiers.end()) {
+		m_error = {error_type::reserved_port_id, -1};
+		if (m_display_messages) {
+			std::string error_message = "Port identifier " + session_identifier + " is reserved for the session handshake.";
+			std::cerr << error_message << std::endl;
+		}
+		return false;
+	}
+	port_options session_options;
+	session_options.framing = framing_mode::length_prefix;
+	m_session_port = std::make_unique<Port>(is_server, working_path, session_identifier, false, end_char, session_options);
+	bool success = (m_session_port->GetErrorState().type == error_type::none);
+	if (!success) {
+		m_error = m_session_port->GetErrorState();
+	}
 	for (auto const& port_identifier : port_identifiers) {
-		ports.emplace(port_identifier, std::make_unique<Port>(is_server, working_path, port_identifier, display_messages, end_char));
-		if (!(ports.at(port_identifier).get()->IsOpened())) {
-			success = false;
-			m_error_code = ports.at(port_identifier)->GetErrorCode();
+		if (!success) {
 			break;
 		}
+		if (m_port_indices.count(port_identifier) > 0) {
+			continue;
+		}
+		m_port_indices.emplace(port_identifier, ports.size());
+		ports.push_back(std::make_unique<Port>(is_server, working_path, port_identifier, display_messages, end_char, options));
+		if (ports.back()->GetErrorState().type != error_type::none) {
+			success = false;
+			m_error = ports.back()->GetErrorState();
+		}
+	}
+	return success;
+}
+
+bool SatTerm_Agent::OpenSession(bool is_server, satterm_deadline deadline, port_options const& options) {
+	// Completes the opening of every Port with one round trip through the session Port, however many Ports there are. The client sends
+	// its hello once its ends of every Port are open, and the server sends its welcome once it has opened its own. The session Port is
+	// closed again afterwards.
+	m_error = {error_type::none, 0};
+	bool success = is_server ? AcceptSession(options, deadline) : RequestSession(deadline);
+	if (!success) {
+		if (m_error.Get().type == error_type::none) {
+			m_error = m_session_port->GetErrorState();
+		}
+		if (is_server) {
+			m_session_port->CompleteServerOpen(false);              // So that a waiting client sees the hang-up rather than timing out.
+		}
+		if (m_display_messages) {
+			std::string error_message = "Session handshake failed with " + GetErrorCode().err_detail;
+			std::cerr << error_message << std::endl;
+		}
 	}
+	m_session_port.reset();
 	return success;
 }
 
+bool SatTerm_Agent::AcceptSession(port_options const& options, satterm_deadline deadline) {
+	std::string hello = "";
+	if (!m_session_port->ReceiveHandshake(hello, deadline)) {
+		return false;
+	}
+	std::vector<std::string> fields = SplitSessionMessage(hello, ' ');
+	if ((fields.size() < 3) || (fields[0] != SESSION_MAGIC)) {
+		m_error = {error_type::invalid_init, -1};
+		return false;
+	}
+	std::vector<std::string> capabilities = SplitSessionMessage(fields[2], ',');
+	auto has_capability = [&capabilities](std::string const& capability) {
+		return (std::find(capabilities.begin(), capabilities.end(), capability) != capabilities.end());
+	};
+	if ((fields[1] != std::to_string(SESSION_VERSION)) ||
+	    ((options.framing == framing_mode::length_prefix) && !has_capability(SESSION_LENGTH_PREFIX)) ||
+	    ((options.transport == transport_mode::seqpacket) && !has_capability(SESSION_SEQPACKET))) {
+		m_error = {error_type::session_incompatible, -1};
+		return false;
+	}
+	if ((fields.size() - 3) != m_ports.size()) {
+		m_error = {error_type::invalid_init, -1};
+		return false;
+	}
+	for (size_t i = 0; i < m_ports.size(); i ++) {
+		if (fields[i + 3] != m_ports[i]->GetIdentifier()) {
+			m_error = {error_type::invalid_init, -1};
+			return false;
+		}
+	}
+	
+	std::string welcome = SESSION_MAGIC + " " + std::to_string(SESSION_VERSION) + " ";
+	welcome += (options.framing == framing_mode::length_prefix) ? SESSION_LENGTH_PREFIX : SESSION_END_CHAR;
+	for (auto& port : m_ports) {
+		if (!port->CompleteServerOpen(has_capability(SESSION_SHARED_MEMORY))) {
+			m_error = port->GetErrorState();
+			return false;
+		}
+		std::string shm_name = port->GetSharedMemoryName();
+		welcome += ' ';
+		welcome += (shm_name.size() > 0) ? shm_name : SESSION_NONE;
+	}
+	if (!m_session_port->CompleteServerOpen(false)) {
+		return false;
+	}
+	m_session_port->SendMessage(welcome, deadline);
+	return (m_session_port->GetErrorState().type == error_type::none);
+}
+
+bool SatTerm_Agent::RequestSession(satterm_deadline deadline) {
+	std::string hello = SESSION_MAGIC + " " + std::to_string(SESSION_VERSION) + " " + SESSION_CAPABILITIES;
+	for (auto const& port : m_ports) {
+		hello += ' ';
+		hello += port->GetIdentifier();
+	}
+	m_session_port->SendMessage(hello, deadline);
+	std::string welcome = "";
+	if ((m_session_port->GetErrorState().type != error_type::none) || !m_session_port->ReceiveHandshake(welcome, deadline)) {
+		return false;
+	}
+	m_session_port->CompleteClientOpen(framing_mode::length_prefix, "");
+	
+	std::vector<std::string> fields = SplitSessionMessage(welcome, ' ');
+	if ((fields.size() < 3) || (fields[0] != SESSION_MAGIC)) {
+		m_error = {error_type::invalid_init, -1};
+		return false;
+	}
+	if (fields[1] != std::to_string(SESSION_VERSION)) {
+		m_error = {error_type::session_incompatible, -1};
+		return false;
+	}
+	if (((fields[2] != SESSION_END_CHAR) && (fields[2] != SESSION_LENGTH_PREFIX)) || ((fields.size() - 3) != m_ports.size())) {
+		m_error = {error_type::invalid_init, -1};
+		return false;
+	}
+	framing_mode framing = (fields[2] == SESSION_LENGTH_PREFIX) ? framing_mode::length_prefix : framing_mode::end_char;
+	for (size_t i = 0; i < m_ports.size(); i ++) {
+		if (!m_ports[i]->CompleteClientOpen(framing, (fields[i + 3] != SESSION_NONE) ? fields[i + 3] : "")) {
+			m_error = m_ports[i]->GetErrorState();
+			return false;
+		}
+	}
+	return true;
+}
+
+std::vector<std::string> SatTerm_Agent::SplitSessionMessage(std::string const& message, char separator) {
+	std::vector<std::string> fields = {};
+	size_t start = 0;
+	while (start <= message.size()) {
+		size_t end = message.find(separator, start);
+		if (end == std::string::npos) {
+			end = message.size();
+		}
+		fields.push_back(message.substr(start, end - start));
+		start = end + 1;
+	}
+	return fields;
+}
+
 std::string SatTerm_Agent::GetMessage(bool capture_end_char, unsigned long timeout_seconds) {
-	return GetMessage(m_default_port_identifier, capture_end_char, timeout_seconds);
+	return GetMessage(m_default_port, capture_end_char, timeout_seconds);
+}
+
+std::string SatTerm_Agent::GetMessage(bool capture_end_char, satterm_duration timeout) {
+	return GetMessage(m_default_port, capture_end_char, timeout);
+}
+
+std::string SatTerm_Agent::GetMessage(bool capture_end_char, satterm_deadline deadline) {
+	return GetMessage(m_default_port, capture_end_char, deadline);
 }
 
 std::string SatTerm_Agent::GetMessage(std::string const& port_identifier, bool capture_end_char, unsigned long timeout_seconds) {
-	m_error_code = {0, ""};
+	return GetMessage(port_identifier, capture_end_char, Port::SecondsToDuration(timeout_seconds));
+}
+
+std::string SatTerm_Agent::GetMessage(std::string const& port_identifier, bool capture_end_char, satterm_duration timeout) {
+	return GetMessage(port_identifier, capture_end_char, Port::DeadlineAfter(timeout));
+}
+
+std::string SatTerm_Agent::GetMessage(std::string const& port_identifier, bool capture_end_char, satterm_deadline deadline) {
+	port_handle port = {};
+	if (!FindPort(port_identifier, "GetMessage()", port)) {
+		return "";
+	}
+	return GetMessage(port, capture_end_char, deadline);
+}
+
+std::string SatTerm_Agent::GetMessage(port_handle port, bool capture_end_char, unsigned long timeout_seconds) {
+	return GetMessage(port, capture_end_char, Port::SecondsToDuration(timeout_seconds));
+}
+
+std::string SatTerm_Agent::GetMessage(port_handle port, bool capture_end_char, satterm_duration timeout) {
+	return GetMessage(port, capture_end_char, Port::DeadlineAfter(timeout));
+}
+
+std::string SatTerm_Agent::GetMessage(port_handle port, bool capture_end_char, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
 	
 	std::string received_message = "";
-	try {
-		received_message = m_ports.at(port_identifier)->GetMessage(capture_end_char, timeout_seconds);
-		m_error_code = m_ports.at(port_identifier)->GetErrorCode();
-		if (m_error_code.err_no != 0) {
-			SetConnectedFlag(m_ports.at(port_identifier)->IsOpened());
+	Port* target = GetPort(port, "GetMessage()");
+	if ((target != NULL) && (m_io_ports.size() > 0) && ReceiveQueuedMessage(port, capture_end_char, deadline)) {
+		received_message = m_io_ports[port.index]->app_rx_item.message;
+	} else if ((target != NULL) && !m_io_running) {
+		received_message = target->GetMessage(capture_end_char, deadline);
+		m_error = target->GetErrorState();
+		if (m_error.Get().type != error_type::none) {
+			SetConnectedFlag(target->IsOpened());
 		}
 	}
+	return received_message;
+}
+
+std::string_view SatTerm_Agent::GetMessageView(bool capture_end_char, unsigned long timeout_seconds) {
+	return GetMessageView(m_default_port, capture_end_char, timeout_seconds);
+}
+
+std::string_view SatTerm_Agent::GetMessageView(bool capture_end_char, satterm_duration timeout) {
+	return GetMessageView(m_default_port, capture_end_char, timeout);
+}
+
+std::string_view SatTerm_Agent::GetMessageView(bool capture_end_char, satterm_deadline deadline) {
+	return GetMessageView(m_default_port, capture_end_char, deadline);
+}
+
+std::string_view SatTerm_Agent::GetMessageView(std::string const& port_identifier, bool capture_end_char, unsigned long timeout_seconds) {
+	return GetMessageView(port_identifier, capture_end_char, Port::SecondsToDuration(timeout_seconds));
+}
+
+std::string_view SatTerm_Agent::GetMessageView(std::string const& port_identifier, bool capture_end_char, satterm_duration timeout) {
+	return GetMessageView(port_identifier, capture_end_char, Port::DeadlineAfter(timeout));
+}
+
+std::string_view SatTerm_Agent::GetMessageView(std::string const& port_identifier, bool capture_end_char, satterm_deadline deadline) {
+	port_handle port = {};
+	if (!FindPort(port_identifier, "GetMessageView()", port)) {
+		return {};
+	}
+	return GetMessageView(port, capture_end_char, deadline);
+}
+
+std::string_view SatTerm_Agent::GetMessageView(port_handle port, bool capture_end_char, unsigned long timeout_seconds) {
+	return GetMessageView(port, capture_end_char, Port::SecondsToDuration(timeout_seconds));
+}
+
+std::string_view SatTerm_Agent::GetMessageView(port_handle port, bool capture_end_char, satterm_duration timeout) {
+	return GetMessageView(port, capture_end_char, Port::DeadlineAfter(timeout));
+}
+
+std::string_view SatTerm_Agent::GetMessageView(port_handle port, bool capture_end_char, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
 	
-	catch (const std::out_of_range& oor) {
-		m_error_code = {-1, "GetMessage()_OOR_port_id"};
-		std::string error_message = "GetMessage() error - No port matches identifier " + port_identifier;
-		std::cerr << error_message << std::endl;
+	// The returned view points into the Port's own buffers, so no copy or allocation is made. It remains valid only until the next call
+	// that receives on this Port (GetMessage(), GetMessageView() or GetReadyPorts()).
+	std::string_view received_message = {};
+	Port* target = GetPort(port, "GetMessageView()");
+	if ((target != NULL) && (m_io_ports.size() > 0) && ReceiveQueuedMessage(port, capture_end_char, deadline)) {
+		received_message = m_io_ports[port.index]->app_rx_item.message;
+	} else if ((target != NULL) && !m_io_running) {
+		received_message = target->GetMessageView(capture_end_char, deadline);
+		m_error = target->GetErrorState();
+		if (m_error.Get().type != error_type::none) {
+			SetConnectedFlag(target->IsOpened());
+		}
 	}
 	return received_message;
 }
 
+size_t SatTerm_Agent::GetMessages(std::vector<std::string>& messages, size_t max_count, bool capture_end_char, unsigned long timeout_seconds) {
+	return GetMessages(m_default_port, messages, max_count, capture_end_char, timeout_seconds);
+}
+
+size_t SatTerm_Agent::GetMessages(std::vector<std::string>& messages, size_t max_count, bool capture_end_char, satterm_duration timeout) {
+	return GetMessages(m_default_port, messages, max_count, capture_end_char, timeout);
+}
+
+size_t SatTerm_Agent::GetMessages(std::vector<std::string>& messages, size_t max_count, bool capture_end_char, satterm_deadline deadline) {
+	return GetMessages(m_default_port, messages, max_count, capture_end_char, deadline);
+}
+
+size_t SatTerm_Agent::GetMessages(std::string const& port_identifier, std::vector<std::string>& messages, size_t max_count, bool capture_end_char,
+                                  unsigned long timeout_seconds) {
+	return GetMessages(port_identifier, messages, max_count, capture_end_char, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Agent::GetMessages(std::string const& port_identifier, std::vector<std::string>& messages, size_t max_count, bool capture_end_char,
+                                  satterm_duration timeout) {
+	return GetMessages(port_identifier, messages, max_count, capture_end_char, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Agent::GetMessages(std::string const& port_identifier, std::vector<std::string>& messages, size_t max_count, bool capture_end_char,
+                                  satterm_deadline deadline) {
+	port_handle port = {};
+	if (!FindPort(port_identifier, "GetMessages()", port)) {
+		return 0;
+	}
+	return GetMessages(port, messages, max_count, capture_end_char, deadline);
+}
+
+size_t SatTerm_Agent::GetMessages(port_handle port, std::vector<std::string>& messages, size_t max_count, bool capture_end_char,
+                                  unsigned long timeout_seconds) {
+	return GetMessages(port, messages, max_count, capture_end_char, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Agent::GetMessages(port_handle port, std::vector<std::string>& messages, size_t max_count, bool capture_end_char,
+                                  satterm_duration timeout) {
+	return GetMessages(port, messages, max_count, capture_end_char, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Agent::GetMessages(port_handle port, std::vector<std::string>& messages, size_t max_count, bool capture_end_char,
+                                  satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
+	
+	// On return the first message_count elements of messages hold the messages received, up to max_count of them; any elements past
+	// that are stale buffers kept for their capacity. Only the first message is waited for; the rest are whatever complete messages were
+	// already available, so a consumer that has fallen behind can catch up in one call.
+	size_t message_count = 0;
+	Port* target = GetPort(port, "GetMessages()");
+	if ((target != NULL) && (m_io_ports.size() > 0)) {
+		satterm_deadline receive_deadline = deadline;
+		while ((message_count < max_count) && ReceiveQueuedMessage(port, capture_end_char, receive_deadline)) {
+			if (message_count < messages.size()) {
+				messages[message_count].swap(m_io_ports[port.index]->app_rx_item.message);
+			} else {
+				messages.emplace_back(std::move(m_io_ports[port.index]->app_rx_item.message));
+			}
+			message_count ++;
+			receive_deadline = satterm_deadline();
+		}
+	}
+	if ((target != NULL) && (message_count == 0) && !m_io_running) {
+		message_count = target->GetMessages(messages, max_count, capture_end_char, deadline);
+		m_error = target->GetErrorState();
+		if (m_error.Get().type != error_type::none) {
+			SetConnectedFlag(target->IsOpened());
+		}
+	}
+	return message_count;
+}
+
+size_t SatTerm_Agent::ReceiveBulk(int descriptor, unsigned long timeout_seconds) {
+	return ReceiveBulk(m_default_port, descriptor, timeout_seconds);
+}
+
+size_t SatTerm_Agent::ReceiveBulk(int descriptor, satterm_duration timeout) {
+	return ReceiveBulk(m_default_port, descriptor, timeout);
+}
+
+size_t SatTerm_Agent::ReceiveBulk(int descriptor, satterm_deadline deadline) {
+	return ReceiveBulk(m_default_port, descriptor, deadline);
+}
+
+size_t SatTerm_Agent::ReceiveBulk(std::string const& port_identifier, int descriptor, unsigned long timeout_seconds) {
+	return ReceiveBulk(port_identifier, descriptor, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Agent::ReceiveBulk(std::string const& port_identifier, int descriptor, satterm_duration timeout) {
+	return ReceiveBulk(port_identifier, descriptor, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Agent::ReceiveBulk(std::string const& port_identifier, int descriptor, satterm_deadline deadline) {
+	port_handle port = {};
+	if (!FindPort(port_identifier, "ReceiveBulk()", port)) {
+		return 0;
+	}
+	return ReceiveBulk(port, descriptor, deadline);
+}
+
+size_t SatTerm_Agent::ReceiveBulk(port_handle port, int descriptor, unsigned long timeout_seconds) {
+	return ReceiveBulk(port, descriptor, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Agent::ReceiveBulk(port_handle port, int descriptor, satterm_duration timeout) {
+	return ReceiveBulk(port, descriptor, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Agent::ReceiveBulk(port_handle port, int descriptor, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
+	
+	// Messages the I/O thread has already read are written out from its queue. Only direct I/O can splice from the fifo.
+	size_t bytes_written = 0;
+	Port* target = GetPort(port, "ReceiveBulk()");
+	bool popped = false;
+	if ((target != NULL) && (m_io_ports.size() > 0)) {
+		popped = ReceiveQueuedMessage(port, false, deadline);
+		if (popped) {
+			std::string const& message = m_io_ports[port.index]->app_rx_item.message;
+			int err_no = 0;
+			bytes_written = Port::WriteToDescriptor(descriptor, message.data(), message.size(), deadline, err_no);
+			if (bytes_written < message.size()) {
+				m_error = {error_type::bulk_output, err_no};
+			}
+		}
+	}
+	if ((target != NULL) && !popped && !m_io_running) {
+		bytes_written = target->ReceiveBulk(descriptor, deadline);
+		m_error = target->GetErrorState();
+		if (m_error.Get().type != error_type::none) {
+			SetConnectedFlag(target->IsOpened());
+		}
+	}
+	return bytes_written;
+}
+
 std::string SatTerm_Agent::SendMessage(std::string const& message, unsigned long timeout_seconds) {
-	return SendMessage(message, m_default_port_identifier, timeout_seconds);
+	return SendMessage(message, m_default_port, timeout_seconds);
+}
+
+std::string SatTerm_Agent::SendMessage(std::string const& message, satterm_duration timeout) {
+	return SendMessage(message, m_default_port, timeout);
+}
+
+std::string SatTerm_Agent::SendMessage(std::string const& message, satterm_deadline deadline) {
+	return SendMessage(message, m_default_port, deadline);
 }
 
 std::string SatTerm_Agent::SendMessage(std::string const& message, std::string const& port_identifier, unsigned long timeout_seconds) {
-	m_error_code = {0, ""};
+	return SendMessage(message, port_identifier, Port::SecondsToDuration(timeout_seconds));
+}
+
+std::string SatTerm_Agent::SendMessage(std::string const& message, std::string const& port_identifier, satterm_duration timeout) {
+	return SendMessage(message, port_identifier, Port::DeadlineAfter(timeout));
+}
+
+std::string SatTerm_Agent::SendMessage(std::string const& message, std::string const& port_identifier, satterm_deadline deadline) {
+	port_handle port = {};
+	if (!FindPort(port_identifier, "SendMessage()", port)) {
+		return "";
+	}
+	return SendMessage(message, port, deadline);
+}
+
+std::string SatTerm_Agent::SendMessage(std::string const& message, port_handle port, unsigned long timeout_seconds) {
+	return SendMessage(message, port, Port::SecondsToDuration(timeout_seconds));
+}
+
+std::string SatTerm_Agent::SendMessage(std::string const& message, port_handle port, satterm_duration timeout) {
+	return SendMessage(message, port, Port::DeadlineAfter(timeout));
+}
+
+std::string SatTerm_Agent::SendMessage(std::string const& message, port_handle port, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
 	
 	std::string remaining_message = "";
-	try {
-		remaining_message = m_ports.at(port_identifier)->SendMessage(message, timeout_seconds);
-		m_error_code = m_ports.at(port_identifier)->GetErrorCode();
-		if (m_error_code.err_no != 0) {
-			SetConnectedFlag(m_ports.at(port_identifier)->IsOpened());
+	Port* target = GetPort(port, "SendMessage()");
+	if ((target != NULL) && m_io_running) {
+		std::string_view message_part = message;
+		if (!SendQueuedMessage(port, &message_part, 1, false, deadline)) {
+			remaining_message = message;
+		}
+	} else if (target != NULL) {
+		remaining_message = target->SendMessage(message, deadline);
+		m_error = target->GetErrorState();
+		if (m_error.Get().type != error_type::none) {
+			SetConnectedFlag(target->IsOpened());
 		}
 	}
+	return remaining_message;
+}
+
+size_t SatTerm_Agent::SendMessage(std::vector<std::string_view> const& message_parts, unsigned long timeout_seconds) {
+	return SendMessage(message_parts, m_default_port, timeout_seconds);
+}
+
+size_t SatTerm_Agent::SendMessage(std::vector<std::string_view> const& message_parts, satterm_duration timeout) {
+	return SendMessage(message_parts, m_default_port, timeout);
+}
+
+size_t SatTerm_Agent::SendMessage(std::vector<std::string_view> const& message_parts, satterm_deadline deadline) {
+	return SendMessage(message_parts, m_default_port, deadline);
+}
+
+size_t SatTerm_Agent::SendMessage(std::vector<std::string_view> const& message_parts, std::string const& port_identifier,
+                                  unsigned long timeout_seconds) {
+	return SendMessage(message_parts, port_identifier, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Agent::SendMessage(std::vector<std::string_view> const& message_parts, std::string const& port_identifier, satterm_duration timeout) {
+	return SendMessage(message_parts, port_identifier, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Agent::SendMessage(std::vector<std::string_view> const& message_parts, std::string const& port_identifier, satterm_deadline deadline) {
+	port_handle port = {};
+	if (!FindPort(port_identifier, "SendMessage()", port)) {
+		return 0;
+	}
+	return SendMessage(message_parts, port, deadline);
+}
+
+size_t SatTerm_Agent::SendMessage(std::vector<std::string_view> const& message_parts, port_handle port, unsigned long timeout_seconds) {
+	return SendMessage(message_parts, port, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Agent::SendMessage(std::vector<std::string_view> const& message_parts, port_handle port, satterm_duration timeout) {
+	return SendMessage(message_parts, port, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Agent::SendMessage(std::vector<std::string_view> const& message_parts, port_handle port, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
 	
-	catch (const std::out_of_range& oor) {
-		m_error_code = {-1, "SendMessage()_OOR_port_id"};
-		std::string error_message = "SendMessage() error - No port matches identifier " + port_identifier;
-		std::cerr << error_message << std::endl;
+	// Sends the concatenation of message_parts as one message without first copying them into a single buffer. Returns the number of
+	// message bytes sent. If that is short of the total, the unsent tail must be sent next to complete the message.
+	size_t sent_bytes = 0;
+	Port* target = GetPort(port, "SendMessage()");
+	if ((target != NULL) && m_io_running) {
+		if (SendQueuedMessage(port, message_parts.data(), message_parts.size(), false, deadline)) {
+			for (auto const& message_part : message_parts) {
+				sent_bytes += message_part.size();
+			}
+		}
+	} else if (target != NULL) {
+		sent_bytes = target->SendMessage(message_parts, deadline);
+		m_error = target->GetErrorState();
+		if (m_error.Get().type != error_type::none) {
+			SetConnectedFlag(target->IsOpened());
+		}
 	}
-	return remaining_message;
+	return sent_bytes;
+}
+
+size_t SatTerm_Agent::SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, unsigned long timeout_seconds) {
+	return SendMessages(messages, remaining_message, m_default_port, timeout_seconds);
+}
+
+size_t SatTerm_Agent::SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, satterm_duration timeout) {
+	return SendMessages(messages, remaining_message, m_default_port, timeout);
+}
+
+size_t SatTerm_Agent::SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, satterm_deadline deadline) {
+	return SendMessages(messages, remaining_message, m_default_port, deadline);
+}
+
+size_t SatTerm_Agent::SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, std::string const& port_identifier,
+                                   unsigned long timeout_seconds) {
+	return SendMessages(messages, remaining_message, port_identifier, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Agent::SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, std::string const& port_identifier,
+                                   satterm_duration timeout) {
+	return SendMessages(messages, remaining_message, port_identifier, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Agent::SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, std::string const& port_identifier,
+                                   satterm_deadline deadline) {
+	port_handle port = {};
+	if (!FindPort(port_identifier, "SendMessages()", port)) {
+		remaining_message = (messages.size() > 0) ? messages[0] : "";
+		return 0;
+	}
+	return SendMessages(messages, remaining_message, port, deadline);
+}
+
+size_t SatTerm_Agent::SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, port_handle port,
+                                   unsigned long timeout_seconds) {
+	return SendMessages(messages, remaining_message, port, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Agent::SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, port_handle port,
+                                   satterm_duration timeout) {
+	return SendMessages(messages, remaining_message, port, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Agent::SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, port_handle port,
+                                   satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
+	
+	// Sends the whole batch with as few writev() calls as possible. Returns the number of messages delivered. If that is less than
+	// messages.size(), remaining_message holds the unsent remainder of the first undelivered message, exactly as SendMessage() would
+	// have returned it, and none of the later messages have been sent.
+	size_t messages_sent = 0;
+	remaining_message.clear();
+	Port* target = GetPort(port, "SendMessages()");
+	if ((target != NULL) && m_io_running) {
+		for (auto const& message : messages) {
+			std::string_view message_part = message;
+			if (!SendQueuedMessage(port, &message_part, 1, false, deadline)) {
+				remaining_message = message;
+				break;
+			}
+			messages_sent ++;
+		}
+	} else if (target != NULL) {
+		messages_sent = target->SendMessages(messages, remaining_message, deadline);
+		m_error = target->GetErrorState();
+		if (m_error.Get().type != error_type::none) {
+			SetConnectedFlag(target->IsOpened());
+		}
+	} else {
+		remaining_message = (messages.size() > 0) ? messages[0] : "";
+	}
+	return messages_sent;
 }
 
 size_t SatTerm_Agent::SendBytes(const char* bytes, size_t byte_count, unsigned long timeout_seconds) {
-	return SendBytes(bytes, byte_count, m_default_port_identifier, timeout_seconds);
+	return SendBytes(bytes, byte_count, m_default_port, timeout_seconds);
+}
+
+size_t SatTerm_Agent::SendBytes(const char* bytes, size_t byte_count, satterm_duration timeout) {
+	return SendBytes(bytes, byte_count, m_default_port, timeout);
+}
+
+size_t SatTerm_Agent::SendBytes(const char* bytes, size_t byte_count, satterm_deadline deadline) {
+	return SendBytes(bytes, byte_count, m_default_port, deadline);
 }
 
 size_t SatTerm_Agent::SendBytes(const char* bytes, size_t byte_count, std::string const& port_identifier, unsigned long timeout_seconds) {
-	m_error_code = {0, ""};
+	return SendBytes(bytes, byte_count, port_identifier, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Agent::SendBytes(const char* bytes, size_t byte_count, std::string const& port_identifier, satterm_duration timeout) {
+	return SendBytes(bytes, byte_count, port_identifier, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Agent::SendBytes(const char* bytes, size_t byte_count, std::string const& port_identifier, satterm_deadline deadline) {
+	port_handle port = {};
+	if (!FindPort(port_identifier, "SendBytes()", port)) {
+		return 0;
+	}
+	return SendBytes(bytes, byte_count, port, deadline);
+}
+
+size_t SatTerm_Agent::SendBytes(const char* bytes, size_t byte_count, port_handle port, unsigned long timeout_seconds) {
+	return SendBytes(bytes, byte_count, port, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Agent::SendBytes(const char* bytes, size_t byte_count, port_handle port, satterm_duration timeout) {
+	return SendBytes(bytes, byte_count, port, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Agent::SendBytes(const char* bytes, size_t byte_count, port_handle port, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
 	
 	size_t sent_bytes = 0;
-	try {
-		sent_bytes = m_ports.at(port_identifier)->SendBytes(bytes, byte_count, timeout_seconds);
-		m_error_code = m_ports.at(port_identifier)->GetErrorCode();
-		if (m_error_code.err_no != 0) {
-			SetConnectedFlag(m_ports.at(port_identifier)->IsOpened());
+	Port* target = GetPort(port, "SendBytes()");
+	if ((target != NULL) && m_io_running) {
+		std::string_view message_part(bytes, byte_count);
+		if (SendQueuedMessage(port, &message_part, 1, true, deadline)) {
+			sent_bytes = byte_count;
+		}
+	} else if (target != NULL) {
+		sent_bytes = target->SendBytes(bytes, byte_count, deadline);
+		m_error = target->GetErrorState();
+		if (m_error.Get().type != error_type::none) {
+			SetConnectedFlag(target->IsOpened());
 		}
 	}
+	return sent_bytes;
+}
+
+size_t SatTerm_Agent::SendBulk(const char* bytes, size_t byte_count, unsigned long timeout_seconds) {
+	return SendBulk(bytes, byte_count, m_default_port, timeout_seconds);
+}
+
+size_t SatTerm_Agent::SendBulk(const char* bytes, size_t byte_count, satterm_duration timeout) {
+	return SendBulk(bytes, byte_count, m_default_port, timeout);
+}
+
+size_t SatTerm_Agent::SendBulk(const char* bytes, size_t byte_count, satterm_deadline deadline) {
+	return SendBulk(bytes, byte_count, m_default_port, deadline);
+}
+
+size_t SatTerm_Agent::SendBulk(const char* bytes, size_t byte_count, std::string const& port_identifier, unsigned long timeout_seconds) {
+	return SendBulk(bytes, byte_count, port_identifier, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Agent::SendBulk(const char* bytes, size_t byte_count, std::string const& port_identifier, satterm_duration timeout) {
+	return SendBulk(bytes, byte_count, port_identifier, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Agent::SendBulk(const char* bytes, size_t byte_count, std::string const& port_identifier, satterm_deadline deadline) {
+	port_handle port = {};
+	if (!FindPort(port_identifier, "SendBulk()", port)) {
+		return 0;
+	}
+	return SendBulk(bytes, byte_count, port, deadline);
+}
+
+size_t SatTerm_Agent::SendBulk(const char* bytes, size_t byte_count, port_handle port, unsigned long timeout_seconds) {
+	return SendBulk(bytes, byte_count, port, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Agent::SendBulk(const char* bytes, size_t byte_count, port_handle port, satterm_duration timeout) {
+	return SendBulk(bytes, byte_count, port, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Agent::SendBulk(const char* bytes, size_t byte_count, port_handle port, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
 	
-	catch (const std::out_of_range& oor) {
-		m_error_code = {-1, "SendBytes()_OOR_port_id"};
-		std::string error_message = "SendBytes() error - No port matches identifier " + port_identifier;
-		std::cerr << error_message << std::endl;
+	// With the I/O thread running the bytes are copied into the outbound queue like any other message, so they may be reused at once.
+	size_t sent_bytes = 0;
+	Port* target = GetPort(port, "SendBulk()");
+	if ((target != NULL) && m_io_running) {
+		std::string_view message_part(bytes, byte_count);
+		if (SendQueuedMessage(port, &message_part, 1, false, deadline)) {
+			sent_bytes = byte_count;
+		}
+	} else if (target != NULL) {
+		sent_bytes = target->SendBulk(bytes, byte_count, deadline);
+		m_error = target->GetErrorState();
+		if (m_error.Get().type != error_type::none) {
+			SetConnectedFlag(target->IsOpened());
+		}
 	}
 	return sent_bytes;
 }
 
+bool SatTerm_Agent::FlushTx(unsigned long timeout_seconds) {
+	return FlushTx(m_default_port, timeout_seconds);
+}
+
+bool SatTerm_Agent::FlushTx(satterm_duration timeout) {
+	return FlushTx(m_default_port, timeout);
+}
+
+bool SatTerm_Agent::FlushTx(satterm_deadline deadline) {
+	return FlushTx(m_default_port, deadline);
+}
+
+bool SatTerm_Agent::FlushTx(std::string const& port_identifier, unsigned long timeout_seconds) {
+	return FlushTx(port_identifier, Port::SecondsToDuration(timeout_seconds));
+}
+
+bool SatTerm_Agent::FlushTx(std::string const& port_identifier, satterm_duration timeout) {
+	return FlushTx(port_identifier, Port::DeadlineAfter(timeout));
+}
+
+bool SatTerm_Agent::FlushTx(std::string const& port_identifier, satterm_deadline deadline) {
+	port_handle port = {};
+	if (!FindPort(port_identifier, "FlushTx()", port)) {
+		return false;
+	}
+	return FlushTx(port, deadline);
+}
+
+bool SatTerm_Agent::FlushTx(port_handle port, unsigned long timeout_seconds) {
+	return FlushTx(port, Port::SecondsToDuration(timeout_seconds));
+}
+
+bool SatTerm_Agent::FlushTx(port_handle port, satterm_duration timeout) {
+	return FlushTx(port, Port::DeadlineAfter(timeout));
+}
+
+bool SatTerm_Agent::FlushTx(port_handle port, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
+	
+	// Sends the end char still owed when a SendMessage() returned no remainder but a write_thread_block error, for a sender with no next
+	// message to carry it. Returns true once nothing is owed. With the I/O thread running, the thread sends it by itself.
+	bool flushed = false;
+	Port* target = GetPort(port, "FlushTx()");
+	if ((target != NULL) && m_io_running) {
+		flushed = true;
+	} else if (target != NULL) {
+		flushed = target->FlushTx(deadline);
+		m_error = target->GetErrorState();
+		if (m_error.Get().type != error_type::none) {
+			SetConnectedFlag(target->IsOpened());
+		}
+	}
+	return flushed;
+}
+
+std::vector<std::string> SatTerm_Agent::GetReadyPorts(unsigned long timeout_seconds, bool writable) {
+	return GetReadyPorts(Port::SecondsToDuration(timeout_seconds), writable);
+}
+
+std::vector<std::string> SatTerm_Agent::GetReadyPorts(satterm_duration timeout, bool writable) {
+	return GetReadyPorts(Port::DeadlineAfter(timeout), writable);
+}
+
+std::vector<std::string> SatTerm_Agent::GetReadyPorts(satterm_deadline deadline, bool writable) {
+	std::vector<port_handle> ready = {};
+	GetReadyPorts(ready, deadline, writable);
+	
+	std::vector<std::string> ready_ports = {};
+	for (auto const& port : ready) {
+		ready_ports.push_back(m_ports[port.index]->GetIdentifier());
+	}
+	return ready_ports;
+}
+
+size_t SatTerm_Agent::GetReadyPorts(std::vector<port_handle>& ready_ports, unsigned long timeout_seconds, bool writable) {
+	return GetReadyPorts(ready_ports, Port::SecondsToDuration(timeout_seconds), writable);
+}
+
+size_t SatTerm_Agent::GetReadyPorts(std::vector<port_handle>& ready_ports, satterm_duration timeout, bool writable) {
+	return GetReadyPorts(ready_ports, Port::DeadlineAfter(timeout), writable);
+}
+
+size_t SatTerm_Agent::GetReadyPorts(std::vector<port_handle>& ready_ports, satterm_deadline deadline, bool writable) {
+	m_error = {error_type::none, 0};
+	
+	// Blocks until at least one Port has a complete message waiting (or, if writable is true, can accept more bytes), or the deadline
+	// passes. On return ready_ports holds the handle of every Port that is ready, and their number is returned. A Port whose counterpart
+	// has disconnected is reported as ready to read so that the following GetMessage() call can report the error.
+	ready_ports.clear();
+	if (m_io_running) {
+		return GetQueuedReadyPorts(ready_ports, deadline, writable);
+	}
+	
+	int epoll_descriptor = GetReadinessDescriptor(writable);
+	if (epoll_descriptor < 0) {
+		return 0;
+	}
+	
+	if (!writable) {
+		// Bytes left over in a Port's receive buffer from an earlier read() will not raise an epoll event, so check these first. Nor will
+		// bytes already in a shared memory ring, as the sender only rings once the receiver has found the ring empty.
+		for (size_t i = 0; i < m_ports.size(); i ++) {
+			bool shared_memory = (m_ports[i]->GetTransportMode() == transport_mode::shared_memory);
+			if (m_ports[i]->HasBufferedMessage() || (shared_memory && m_ports[i]->IsOpened() && m_ports[i]->IsMessageReady())) {
+				ready_ports.push_back({i});
+			}
+		}
+	}
+	
+	const int max_events = 64;
+	struct epoll_event events[max_events];
+	bool finished = false;
+	while (!finished) {
+		int timeout_ms = 0;
+		if (ready_ports.size() == 0) {
+			satterm_duration remaining = deadline - satterm_clock::now();
+			if (remaining > satterm_duration::zero()) {
+				long long remaining_ms = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+				timeout_ms = (remaining_ms < 60000) ? (int)(remaining_ms) : 60000;
+			}
+		}
+		
+		int event_count = epoll_wait(epoll_descriptor, events, max_events, timeout_ms);
+		
+		if (event_count < 0) {
+			if (errno != EINTR) {
+				m_error = {error_type::epoll_wait, errno};
+				finished = true;
+			}
+		}
+		for (int i = 0; i < event_count; i ++) {
+			port_handle ready_port = {(size_t)(events[i].data.u64)};
+			Port* port = m_ports[ready_port.index].get();
+			if (!port->IsOpened()) {
+				// The Port has already reported its disconnection. Stop watching it, else a hung-up fifo will wake us forever.
+				epoll_ctl(epoll_descriptor, EPOLL_CTL_DEL, writable ? port->GetTxDescriptor() : port->GetRxDescriptor(), NULL);
+				continue;
+			}
+			if (writable || port->IsMessageReady()) {
+				if (std::find(ready_ports.begin(), ready_ports.end(), ready_port) == ready_ports.end()) {
+					ready_ports.push_back(ready_port);
+				}
+			}
+		}
+		if ((ready_ports.size() > 0) || (satterm_clock::now() >= deadline)) {
+			finished = true;
+		}
+	}
+	return ready_ports.size();
+}
+
+void SatTerm_Agent::OnMessage(std::string const& port_identifier, satterm_message_handler handler) {
+	m_error = {error_type::none, 0};
+	
+	port_handle port = {};
+	if (FindPort(port_identifier, "OnMessage()", port)) {
+		OnMessage(port, handler);
+	}
+}
+
+void SatTerm_Agent::OnMessage(port_handle port, satterm_message_handler handler) {
+	// Registers the handler to which Run() dispatches each message received on the Port. Pass nullptr to remove it.
+	m_error = {error_type::none, 0};
+	
+	if (GetPort(port, "OnMessage()") != NULL) {
+		if (m_message_handlers.size() < m_ports.size()) {
+			m_message_handlers.resize(m_ports.size());
+		}
+		m_message_handlers[port.index] = handler;
+	}
+}
+
+void SatTerm_Agent::OnDisconnect(satterm_disconnect_handler handler) {
+	m_disconnect_handler = handler;
+}
+
+size_t SatTerm_Agent::Run(void) {
+	return RunUntil(satterm_deadline::max());
+}
+
+size_t SatTerm_Agent::RunFor(satterm_duration duration) {
+	return RunUntil(Port::DeadlineAfter(duration));
+}
+
+size_t SatTerm_Agent::RunUntil(satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
+	
+	// Sleeps in GetReadyPorts() and dispatches each complete message to its Port's handler as soon as it arrives. Returns when Stop() is
+	// called (normally from within a handler), the connection is lost or the deadline passes, giving the number of messages dispatched.
+	// Messages arriving on a Port with no handler are discarded. Messages are taken one at a time so that none are lost on Stop().
+	size_t dispatched_count = 0;
+	std::vector<port_handle> ready_ports = {};
+	std::vector<std::string> messages = {};
+	error_state disconnect_error = {error_type::none, 0};
+	
+	m_reactor_stop = false;
+	while (!m_reactor_stop && IsConnected() && (satterm_clock::now() < deadline)) {
+		GetReadyPorts(ready_ports, deadline);
+		if (m_error.Get().type != error_type::none) {
+			break;
+		}
+		for (size_t i = 0; (i < ready_ports.size()) && !m_reactor_stop; i ++) {
+			port_handle port = ready_ports[i];
+			bool port_drained = false;
+			while (!port_drained && !m_reactor_stop) {
+				port_drained = (GetMessages(port, messages, 1, false, satterm_deadline()) == 0);
+				error_state error = m_error;
+				if (!port_drained && (port.index < m_message_handlers.size()) && m_message_handlers[port.index]) {
+					m_message_handlers[port.index](messages[0]);
+					dispatched_count ++;
+				}
+				if (error.type != error_type::none) {
+					if (!IsConnected() && m_disconnect_handler) {
+						m_disconnect_handler(GetPortIdentifier(port), Port::DescribeError(error));
+					}
+					disconnect_error = error;
+					port_drained = true;
+				}
+			}
+		}
+	}
+	if (disconnect_error.type != error_type::none) {
+		m_error = disconnect_error;
+	}
+	return dispatched_count;
+}
+
+void SatTerm_Agent::Stop(void) {
+	// Makes Run() return once the handler that called Stop() returns.
+	m_reactor_stop = true;
+}
+
+int SatTerm_Agent::GetReadinessDescriptor(bool writable) {
+	// Lazily creates an epoll instance watching either the rx or the tx fifo of every Port.
+	int& epoll_descriptor = writable ? m_tx_epoll_descriptor : m_rx_epoll_descriptor;
+	if (epoll_descriptor < 0) {
+		epoll_descriptor = epoll_create1(EPOLL_CLOEXEC);
+		if (epoll_descriptor < 0) {
+			m_error = {error_type::epoll_create1, errno};
+			return -1;
+		}
+		for (size_t i = 0; i < m_ports.size(); i ++) {
+			if (m_ports[i]->IsOpened()) {
+				struct epoll_event event = {};
+				event.events = writable ? EPOLLOUT : EPOLLIN;
+				event.data.u64 = i;
+				int descriptor = writable ? m_ports[i]->GetTxDescriptor() : m_ports[i]->GetRxDescriptor();
+				if (epoll_ctl(epoll_descriptor, EPOLL_CTL_ADD, descriptor, &event) < 0) {
+					m_error = {error_type::epoll_ctl, errno};
+					close(epoll_descriptor);
+					epoll_descriptor = -1;
+					return -1;
+				}
+			}
+		}
+	}
+	return epoll_descriptor;
+}
+
+int SatTerm_Agent::GetPortDescriptor(port_handle port, bool writable) {
+	// Returns the Port's tx or rx fifo descriptor for an external event loop to watch, or -1 if the handle is out of range.
+	if (port.index >= m_ports.size()) {
+		return -1;
+	}
+	return writable ? m_ports[port.index]->GetTxDescriptor() : m_ports[port.index]->GetRxDescriptor();
+}
+
 error_descriptor SatTerm_Agent::GetErrorCode(void) {
-	return m_error_code;
+	return Port::DescribeError(m_error);
+}
+
+error_state SatTerm_Agent::GetErrorState(void) {
+	return m_error;
 }
 
 std::string SatTerm_Agent::GetStopPortIdentifier(void) {
@@ -130,11 +1057,81 @@ std::string SatTerm_Agent::GetStopMessage(void) {
 std::vector<std::string> SatTerm_Agent::GetPortIdentifiers(void) {
 	std::vector<std::string> port_identifiers = {};
 	for (const auto& port : m_ports) {
-		port_identifiers.push_back(port.first);
+		port_identifiers.push_back(port->GetIdentifier());
 	}
 	return port_identifiers;
 }
 
+port_handle SatTerm_Agent::GetPortHandle(std::string const& port_identifier) {
+	// Look the handle up once and keep it. Handle-based calls index straight into the Port storage, with no string comparisons.
+	m_error = {error_type::none, 0};
+	
+	port_handle port = {m_ports.size()};
+	FindPort(port_identifier, "GetPortHandle()", port);
+	return port;
+}
+
+std::string SatTerm_Agent::GetPortIdentifier(port_handle port) {
+	std::string port_identifier = "";
+	if (port.index < m_ports.size()) {
+		port_identifier = m_ports[port.index]->GetIdentifier();
+	}
+	return port_identifier;
+}
+
+size_t SatTerm_Agent::GetPipeSize(std::string const& port_identifier, bool writable) {
+	port_handle port = {m_ports.size()};
+	FindPort(port_identifier, "GetPipeSize()", port);
+	return GetPipeSize(port, writable);
+}
+
+size_t SatTerm_Agent::GetPipeSize(port_handle port, bool writable) {
+	// Returns the capacity of the Port's tx (writable) or rx fifo, as granted by the kernel, or 0 if the port is unknown or not open.
+	size_t pipe_size = 0;
+	if (port.index < m_ports.size()) {
+		pipe_size = m_ports[port.index]->GetPipeSize(writable);
+	}
+	return pipe_size;
+}
+
+size_t SatTerm_Agent::GetUnreadBytes(std::string const& port_identifier) {
+	port_handle port = {m_ports.size()};
+	FindPort(port_identifier, "GetUnreadBytes()", port);
+	return GetUnreadBytes(port);
+}
+
+size_t SatTerm_Agent::GetUnreadBytes(port_handle port) {
+	// Returns the number of bytes sent on the Port that the counterpart has not yet read, or 0 if the port is unknown or not open. Messages
+	// still waiting in the I/O thread's outbound queue are not counted.
+	size_t byte_count = 0;
+	if (port.index < m_ports.size()) {
+		byte_count = m_ports[port.index]->GetUnreadBytes();
+	}
+	return byte_count;
+}
+
+bool SatTerm_Agent::FindPort(std::string const& port_identifier, const char* caller, port_handle& port) {
+	std::map<std::string, size_t>::const_iterator itr = m_port_indices.find(port_identifier);
+	if ((itr == m_port_indices.end()) || (itr->second >= m_ports.size())) {
+		m_error = {error_type::oor_port_id, -1, caller};
+		std::string error_message = std::string(caller) + " error - No port matches identifier " + port_identifier;
+		std::cerr << error_message << std::endl;
+		return false;
+	}
+	port = {itr->second};
+	return true;
+}
+
+Port* SatTerm_Agent::GetPort(port_handle port, const char* caller) {
+	if (port.index >= m_ports.size()) {
+		m_error = {error_type::oor_port_handle, -1, caller};
+		std::string error_message = std::string(caller) + " error - No port matches handle " + std::to_string(port.index);
+		std::cerr << error_message << std::endl;
+		return NULL;
+	}
+	return m_ports[port.index].get();
+}
+
 bool SatTerm_Agent::IsConnected(void) {
 	return m_connected;
 }
@@ -0,0 +1,440 @@
+// -----------------------------------------------------------------------------------------------------
+// satellite_terminal - Easily spawn and communicate bidirectionally with client processes in separate
+//                      terminal emulator instances.
+// -----------------------------------------------------------------------------------------------------
+// seb.nf.sikora@protonmail.com
+//
+// Copyright © 2021 Dr Seb N.F. Sikora.
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+// -----------------------------------------------------------------------------------------------------
+
+#include <string>                     // std::string.
+#include <vector>                     // std::vector.
+#include <memory>                     // std::unique_ptr, std::make_unique.
+#include <functional>                 // std::function.
+#include <thread>                     // std::thread.
+#include <system_error>               // std::system_error.
+#include <algorithm>                  // std::find.
+#include <chrono>                     // std::chrono::ceil.
+
+#include <errno.h>                    // errno.
+#include <stdint.h>                   // uint64_t.
+#include <unistd.h>                   // read(), write(), close().
+#include <sys/epoll.h>                // epoll_create1(), epoll_ctl(), epoll_wait().
+#include <sys/eventfd.h>              // eventfd().
+
+#include "satellite_terminal.h"
+
+#if defined(__cpp_impl_coroutine)
+
+static satterm_deadline AsyncDeadlineAfter(satterm_duration timeout) {
+	// satterm_duration::max() (the default for the async calls) means wait indefinitely, so clamp rather than overflow.
+	satterm_deadline now = satterm_clock::now();
+	if (timeout >= (satterm_deadline::max() - now)) {
+		return satterm_deadline::max();
+	}
+	return now + timeout;
+}
+
+// -----------------------------------------------------------------------------------------------------
+// SatTerm_Agent.
+
+satterm_receive_operation SatTerm_Agent::ReceiveAsync(bool capture_end_char, satterm_duration timeout) {
+	return ReceiveAsync(m_default_port, capture_end_char, AsyncDeadlineAfter(timeout));
+}
+
+satterm_receive_operation SatTerm_Agent::ReceiveAsync(bool capture_end_char, satterm_deadline deadline) {
+	return ReceiveAsync(m_default_port, capture_end_char, deadline);
+}
+
+satterm_receive_operation SatTerm_Agent::ReceiveAsync(std::string const& port_identifier, bool capture_end_char, satterm_duration timeout) {
+	return ReceiveAsync(port_identifier, capture_end_char, AsyncDeadlineAfter(timeout));
+}
+
+satterm_receive_operation SatTerm_Agent::ReceiveAsync(std::string const& port_identifier, bool capture_end_char, satterm_deadline deadline) {
+	return ReceiveAsync(GetPortHandle(port_identifier), capture_end_char, deadline);      // An unknown identifier yields an out-of-range handle.
+}
+
+satterm_receive_operation SatTerm_Agent::ReceiveAsync(port_handle port, bool capture_end_char, satterm_duration timeout) {
+	return ReceiveAsync(port, capture_end_char, AsyncDeadlineAfter(timeout));
+}
+
+satterm_receive_operation SatTerm_Agent::ReceiveAsync(port_handle port, bool capture_end_char, satterm_deadline deadline) {
+	return satterm_receive_operation(this, port, capture_end_char, deadline);
+}
+
+satterm_send_operation SatTerm_Agent::SendAsync(std::string const& message, satterm_duration timeout) {
+	return SendAsync(message, m_default_port, AsyncDeadlineAfter(timeout));
+}
+
+satterm_send_operation SatTerm_Agent::SendAsync(std::string const& message, satterm_deadline deadline) {
+	return SendAsync(message, m_default_port, deadline);
+}
+
+satterm_send_operation SatTerm_Agent::SendAsync(std::string const& message, std::string const& port_identifier, satterm_duration timeout) {
+	return SendAsync(message, port_identifier, AsyncDeadlineAfter(timeout));
+}
+
+satterm_send_operation SatTerm_Agent::SendAsync(std::string const& message, std::string const& port_identifier, satterm_deadline deadline) {
+	return SendAsync(message, GetPortHandle(port_identifier), deadline);
+}
+
+satterm_send_operation SatTerm_Agent::SendAsync(std::string const& message, port_handle port, satterm_duration timeout) {
+	return SendAsync(message, port, AsyncDeadlineAfter(timeout));
+}
+
+satterm_send_operation SatTerm_Agent::SendAsync(std::string const& message, port_handle port, satterm_deadline deadline) {
+	return satterm_send_operation(this, port, message, deadline);
+}
+
+satterm_connect_operation SatTerm_Server::ConnectAsync(std::string const& identifier, std::string const& path_to_client_binary, bool display_messages,
+                                                       std::vector<std::string> port_identifiers, std::string const& stop_message,
+                                                       std::string const& path_to_terminal_emulator_paths,
+                                                       char end_char, std::string const& stop_port_identifier,
+                                                       satterm_duration timeout, port_options const& options, launch_options const& launch) {
+	return satterm_connect_operation([=]() {
+		return std::make_unique<SatTerm_Server>(identifier, path_to_client_binary, display_messages, port_identifiers, stop_message,
+		                                        path_to_terminal_emulator_paths, end_char, stop_port_identifier, timeout, options, launch);
+	});
+}
+
+// -----------------------------------------------------------------------------------------------------
+// Awaitables.
+
+bool satterm_async_operation::Suspend(std::coroutine_handle<SatTerm_Task::promise_type> handle) {
+	// Hands the operation to the awaiting task's loop. Returns false (resume immediately, with error set) if it cannot be watched.
+	awaiter = handle;
+	SatTerm_Loop* loop = handle.promise().loop;
+	if (loop == nullptr) {
+		error = {error_type::no_event_loop, -1};
+		return false;
+	}
+	if (!loop->Watch(this)) {
+		error = {error_type::epoll_ctl, errno};
+		return false;
+	}
+	return true;
+}
+
+satterm_receive_operation::satterm_receive_operation(SatTerm_Agent* agent, port_handle port, bool capture_end_char, satterm_deadline deadline) :
+                                                     agent(agent), port(port), capture_end_char(capture_end_char) {
+	this->deadline = deadline;
+	events = EPOLLIN;
+}
+
+bool satterm_receive_operation::TryComplete(void) {
+	// Only ever reads what is already available, so the loop thread never blocks here. A shared memory Port must also be readied before
+	// the loop sleeps on its descriptor, which IsMessageReady() does.
+	message_count = agent->GetMessages(port, messages, 1, capture_end_char, satterm_deadline());
+	error = agent->m_error;
+	if ((message_count == 0) && (error.type == error_type::none)) {
+		Port* receiving_port = agent->GetPort(port, "ReceiveAsync");
+		if ((receiving_port->GetTransportMode() == transport_mode::shared_memory) && receiving_port->IsMessageReady()) {
+			message_count = agent->GetMessages(port, messages, 1, capture_end_char, satterm_deadline());
+			error = agent->m_error;
+		}
+	}
+	return ((message_count > 0) || (error.type != error_type::none));
+}
+
+bool satterm_receive_operation::await_ready(void) {
+	return TryComplete();
+}
+
+bool satterm_receive_operation::await_suspend(std::coroutine_handle<SatTerm_Task::promise_type> handle) {
+	descriptor = agent->GetPortDescriptor(port, false);
+	return Suspend(handle);
+}
+
+std::string satterm_receive_operation::await_resume(void) {
+	if (timed_out) {
+		error = {error_type::tx_conn_timeout, EAGAIN};
+	}
+	agent->m_error = error;                     // Report the outcome through the agent as the synchronous calls do.
+	if (message_count > 0) {
+		return std::move(messages[0]);
+	}
+	return "";
+}
+
+satterm_send_operation::satterm_send_operation(SatTerm_Agent* agent, port_handle port, std::string const& message, satterm_deadline deadline) :
+                                               agent(agent), port(port), remaining_message(message) {
+	this->deadline = deadline;
+	events = EPOLLOUT;
+}
+
+bool satterm_send_operation::TryComplete(void) {
+	if (framing_owed) {                                         // Only the end char is still owed. Resending the (empty) remainder would
+		Port* sending_port = agent->GetPort(port, "SendAsync");  // frame an extra message.
+		framing_owed = !sending_port->FlushTx(satterm_deadline());
+		error = sending_port->GetErrorState();
+	} else {
+		remaining_message = agent->SendMessage(remaining_message, port, satterm_deadline());
+		error = agent->m_error;
+		framing_owed = ((error.type == error_type::write_thread_block) && (remaining_message.size() == 0));
+	}
+	if (error.type == error_type::write_thread_block) {        // The fifo is full. Wait for the reader to drain it and carry on from here.
+		error = {error_type::none, 0};
+		return false;
+	}
+	return true;
+}
+
+bool satterm_send_operation::await_ready(void) {
+	return TryComplete();
+}
+
+bool satterm_send_operation::await_suspend(std::coroutine_handle<SatTerm_Task::promise_type> handle) {
+	descriptor = agent->GetPortDescriptor(port, true);
+	return Suspend(handle);
+}
+
+std::string satterm_send_operation::await_resume(void) {
+	if (timed_out) {
+		error = {error_type::write_thread_block_timeout, EAGAIN};
+	}
+	agent->m_error = error;
+	return std::move(remaining_message);
+}
+
+satterm_connect_operation::satterm_connect_operation(std::function<std::unique_ptr<SatTerm_Server>(void)> connect) : connect(connect) {
+	events = EPOLLIN;
+}
+
+satterm_connect_operation::~satterm_connect_operation() {
+	if (connect_thread.joinable()) {             // Only if the loop is torn down mid-handshake. The handshake has its own timeout.
+		connect_thread.join();
+	}
+	if (descriptor >= 0) {
+		close(descriptor);
+	}
+}
+
+bool satterm_connect_operation::TryComplete(void) {
+	uint64_t event_count = 0;
+	if (read(descriptor, &event_count, sizeof(event_count)) != (ssize_t)(sizeof(event_count))) {
+		return false;
+	}
+	connect_thread.join();
+	return true;
+}
+
+bool satterm_connect_operation::await_ready(void) {
+	return false;
+}
+
+bool satterm_connect_operation::await_suspend(std::coroutine_handle<SatTerm_Task::promise_type> handle) {
+	descriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (descriptor >= 0) {
+		try {
+			connect_thread = std::thread([this]() {
+				server = connect();
+				uint64_t event_count = 1;
+				ssize_t status = write(descriptor, &event_count, sizeof(event_count));
+				(void)(status);
+			});
+		} catch (std::system_error const&) {
+			close(descriptor);
+			descriptor = -1;
+		}
+	}
+	if (descriptor < 0) {                        // Cannot hand the handshake off, so fall back to connecting on the loop thread.
+		server = connect();
+		return false;
+	}
+	if (!Suspend(handle)) {
+		connect_thread.join();
+		return false;
+	}
+	return true;
+}
+
+std::unique_ptr<SatTerm_Server> satterm_connect_operation::await_resume(void) {
+	return std::move(server);
+}
+
+// -----------------------------------------------------------------------------------------------------
+// SatTerm_Loop.
+
+SatTerm_Loop::SatTerm_Loop() {
+	m_epoll_descriptor = epoll_create1(EPOLL_CLOEXEC);
+	if (m_epoll_descriptor < 0) {
+		m_error = {error_type::epoll_create1, errno};
+	}
+}
+
+SatTerm_Loop::~SatTerm_Loop() {
+	m_operations.clear();                        // Pending operations live in the task frames destroyed below.
+	for (std::coroutine_handle<SatTerm_Task::promise_type> task : m_tasks) {
+		task.destroy();
+	}
+	if (m_epoll_descriptor >= 0) {
+		close(m_epoll_descriptor);
+	}
+}
+
+void SatTerm_Loop::Spawn(SatTerm_Task task) {
+	std::coroutine_handle<SatTerm_Task::promise_type> handle = task.Release();
+	if (handle) {
+		handle.promise().loop = this;
+		m_tasks.push_back(handle);
+		m_scheduled.push_back(handle);            // Tasks start suspended and first run inside Run().
+	}
+}
+
+size_t SatTerm_Loop::Run(void) {
+	return RunUntil(satterm_deadline::max());
+}
+
+size_t SatTerm_Loop::RunFor(satterm_duration duration) {
+	return RunUntil(AsyncDeadlineAfter(duration));
+}
+
+size_t SatTerm_Loop::RunUntil(satterm_deadline deadline) {
+	// Resumes tasks as the operations they await complete or time out, until every task has finished, Stop() is called or the deadline
+	// passes. Returns the number of tasks still unfinished.
+	m_stop = false;
+	
+	const int max_events = 64;
+	struct epoll_event events[max_events];
+	
+	while (!m_stop) {
+		ResumeScheduled();
+		
+		for (size_t i = 0; i < m_tasks.size(); ) {
+			if (m_tasks[i].done()) {
+				m_tasks[i].destroy();
+				m_tasks[i] = m_tasks.back();
+				m_tasks.pop_back();
+			} else {
+				i ++;
+			}
+		}
+		
+		satterm_deadline now = satterm_clock::now();
+		if ((m_tasks.size() == 0) || m_stop || (now >= deadline) || (m_epoll_descriptor < 0)) {
+			break;
+		}
+		
+		satterm_deadline wake = deadline;
+		for (satterm_async_operation* operation : m_operations) {
+			if (operation->deadline < wake) {
+				wake = operation->deadline;
+			}
+		}
+		int timeout_ms = 0;
+		satterm_duration remaining = wake - now;
+		if (remaining > satterm_duration::zero()) {
+			long long remaining_ms = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+			timeout_ms = (remaining_ms < 60000) ? (int)(remaining_ms) : 60000;
+		}
+		
+		int event_count = epoll_wait(m_epoll_descriptor, events, max_events, timeout_ms);
+		
+		if (event_count < 0) {
+			if (errno != EINTR) {
+				m_error = {error_type::epoll_wait, errno};
+				break;
+			}
+		}
+		for (int i = 0; i < event_count; i ++) {
+			// A descriptor may be awaited by more than one operation (a seqpacket Port sends and receives on one socket), so the events are
+			// handed to each operation waiting for them. Errors and hangups go to them all, so that each can report the disconnect.
+			m_ready_operations.clear();
+			for (satterm_async_operation* operation : m_operations) {
+				if ((operation->descriptor == events[i].data.fd) &&
+				    ((operation->events & events[i].events) || (events[i].events & (EPOLLERR | EPOLLHUP)))) {
+					m_ready_operations.push_back(operation);
+				}
+			}
+			for (satterm_async_operation* operation : m_ready_operations) {
+				if (operation->TryComplete()) {
+					Unwatch(operation);
+					m_scheduled.push_back(operation->awaiter);
+				}
+			}
+		}
+		
+		now = satterm_clock::now();
+		for (size_t i = 0; i < m_operations.size(); ) {
+			satterm_async_operation* operation = m_operations[i];
+			if (operation->deadline <= now) {
+				operation->timed_out = true;
+				Unwatch(operation);
+				m_scheduled.push_back(operation->awaiter);
+			} else {
+				i ++;
+			}
+		}
+	}
+	return m_tasks.size();
+}
+
+void SatTerm_Loop::Stop(void) {
+	m_stop = true;
+}
+
+size_t SatTerm_Loop::GetTaskCount(void) {
+	return m_tasks.size();
+}
+
+error_descriptor SatTerm_Loop::GetErrorCode(void) {
+	return Port::DescribeError(m_error);
+}
+
+bool SatTerm_Loop::Watch(satterm_async_operation* operation) {
+	// Each descriptor is registered once, for the events of every operation awaiting it, as epoll refuses a second registration.
+	uint32_t watched_events = GetWatchedEvents(operation->descriptor);
+	struct epoll_event event = {};
+	event.events = watched_events | operation->events;
+	event.data.fd = operation->descriptor;
+	if (epoll_ctl(m_epoll_descriptor, (watched_events != 0) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD, operation->descriptor, &event) < 0) {
+		return false;
+	}
+	m_operations.push_back(operation);
+	return true;
+}
+
+void SatTerm_Loop::Unwatch(satterm_async_operation* operation) {
+	std::vector<satterm_async_operation*>::iterator position = std::find(m_operations.begin(), m_operations.end(), operation);
+	if (position != m_operations.end()) {
+		*position = m_operations.back();
+		m_operations.pop_back();
+	}
+	uint32_t watched_events = GetWatchedEvents(operation->descriptor);
+	if (watched_events == 0) {
+		epoll_ctl(m_epoll_descriptor, EPOLL_CTL_DEL, operation->descriptor, NULL);
+	} else {
+		struct epoll_event event = {};
+		event.events = watched_events;
+		event.data.fd = operation->descriptor;
+		epoll_ctl(m_epoll_descriptor, EPOLL_CTL_MOD, operation->descriptor, &event);
+	}
+}
+
+uint32_t SatTerm_Loop::GetWatchedEvents(int descriptor) {
+	// Returns the events awaited on descriptor by the operations being watched, or 0 if it is not registered.
+	uint32_t watched_events = 0;
+	for (satterm_async_operation* operation : m_operations) {
+		if (operation->descriptor == descriptor) {
+			watched_events |= operation->events;
+		}
+	}
+	return watched_events;
+}
+
+void SatTerm_Loop::ResumeScheduled(void) {
+	// Resumed tasks may schedule others (eg by completing an operation immediately), so drain until nothing is left.
+	std::vector<std::coroutine_handle<>> scheduled = {};
+	while (m_scheduled.size() > 0) {
+		scheduled.swap(m_scheduled);
+		for (std::coroutine_handle<> handle : scheduled) {
+			handle.resume();
+		}
+		scheduled.clear();
+	}
+}
+
+#endif
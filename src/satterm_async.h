@@ -0,0 +1,182 @@
+// -----------------------------------------------------------------------------------------------------
+// satellite_terminal - Easily spawn and communicate bidirectionally with client processes in separate
+//                      terminal emulator instances.
+// -----------------------------------------------------------------------------------------------------
+// seb.nf.sikora@protonmail.com
+//
+// Copyright © 2021 Dr Seb N.F. Sikora.
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+// -----------------------------------------------------------------------------------------------------
+
+#include <string>                    // std::string.
+#include <vector>                    // std::vector.
+#include <memory>                    // std::unique_ptr.
+#include <functional>                // std::function.
+#include <thread>                    // std::thread.
+#include <coroutine>                 // std::coroutine_handle, std::suspend_always, std::noop_coroutine.
+#include <cstdint>                   // uint32_t.
+
+class SatTerm_Agent;
+class SatTerm_Server;
+class SatTerm_Loop;
+
+// Return type of a coroutine run on a SatTerm_Loop. Hand a top-level task to SatTerm_Loop::Spawn(). A task may also co_await another
+// task, which then runs on the same loop and resumes the awaiting task when it finishes.
+class SatTerm_Task {
+	public:
+		struct promise_type;
+		
+		struct final_awaiter {
+			bool await_ready(void) noexcept {
+				return false;
+			}
+			std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept {
+				std::coroutine_handle<> continuation = handle.promise().continuation;
+				return continuation ? continuation : std::noop_coroutine();
+			}
+			void await_resume(void) noexcept {}
+		};
+		
+		struct promise_type {
+			SatTerm_Loop* loop = nullptr;
+			std::coroutine_handle<> continuation = nullptr;          // The task awaiting this one, if any.
+			
+			SatTerm_Task get_return_object(void) {
+				return SatTerm_Task(std::coroutine_handle<promise_type>::from_promise(*this));
+			}
+			std::suspend_always initial_suspend(void) noexcept {
+				return {};
+			}
+			final_awaiter final_suspend(void) noexcept {
+				return {};
+			}
+			void return_void(void) {}
+			void unhandled_exception(void) {
+				std::terminate();
+			}
+		};
+		
+		SatTerm_Task(SatTerm_Task&& rhs) noexcept : m_handle(rhs.m_handle) {
+			rhs.m_handle = nullptr;
+		}
+		SatTerm_Task(SatTerm_Task const&) = delete;
+		SatTerm_Task& operator=(SatTerm_Task const&) = delete;
+		~SatTerm_Task() {
+			if (m_handle) {
+				m_handle.destroy();
+			}
+		}
+		
+		bool await_ready(void) {
+			return (!m_handle || m_handle.done());
+		}
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> awaiter) {
+			m_handle.promise().loop = awaiter.promise().loop;
+			m_handle.promise().continuation = awaiter;
+			return m_handle;
+		}
+		void await_resume(void) {}
+		
+		std::coroutine_handle<promise_type> Release(void) {
+			std::coroutine_handle<promise_type> handle = m_handle;
+			m_handle = nullptr;
+			return handle;
+		}
+	
+	private:
+		explicit SatTerm_Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+		std::coroutine_handle<promise_type> m_handle = nullptr;
+};
+
+// Something a task is waiting for. The loop watches descriptor for events and calls TryComplete() each time it is ready, resuming the
+// task once TryComplete() returns true or the deadline passes (in which case timed_out is set).
+struct satterm_async_operation {
+	virtual ~satterm_async_operation() {}
+	virtual bool TryComplete(void) = 0;
+	
+	std::coroutine_handle<> awaiter = nullptr;
+	int descriptor = -1;
+	uint32_t events = 0;
+	satterm_deadline deadline = satterm_deadline::max();
+	bool timed_out = false;
+	error_state error = {error_type::none, 0};
+	
+	protected:
+		bool Suspend(std::coroutine_handle<SatTerm_Task::promise_type> handle);
+};
+
+// Awaitable returned by SatTerm_Agent::ReceiveAsync(). Resumes with the next message received on the Port.
+struct satterm_receive_operation : public satterm_async_operation {
+	satterm_receive_operation(SatTerm_Agent* agent, port_handle port, bool capture_end_char, satterm_deadline deadline);
+	bool TryComplete(void) override;
+	bool await_ready(void);
+	bool await_suspend(std::coroutine_handle<SatTerm_Task::promise_type> handle);
+	std::string await_resume(void);
+	
+	SatTerm_Agent* agent;
+	port_handle port;
+	bool capture_end_char;
+	std::vector<std::string> messages = {};
+	size_t message_count = 0;                    // Valid elements of messages; GetMessages() does not shrink the vector.
+};
+
+// Awaitable returned by SatTerm_Agent::SendAsync(). Resumes once the whole message is sent, with any unsent remainder (as SendMessage()).
+struct satterm_send_operation : public satterm_async_operation {
+	satterm_send_operation(SatTerm_Agent* agent, port_handle port, std::string const& message, satterm_deadline deadline);
+	bool TryComplete(void) override;
+	bool await_ready(void);
+	bool await_suspend(std::coroutine_handle<SatTerm_Task::promise_type> handle);
+	std::string await_resume(void);
+	
+	SatTerm_Agent* agent;
+	port_handle port;
+	std::string remaining_message;
+	bool framing_owed = false;                   // remaining_message was sent but for its end char.
+};
+
+// Awaitable returned by SatTerm_Server::ConnectAsync(). The server is constructed, and so connects, on a helper thread, and the task
+// resumes with it once the constructor has returned. Check IsConnected() on the result as usual.
+struct satterm_connect_operation : public satterm_async_operation {
+	satterm_connect_operation(std::function<std::unique_ptr<SatTerm_Server>(void)> connect);
+	~satterm_connect_operation();
+	bool TryComplete(void) override;
+	bool await_ready(void);
+	bool await_suspend(std::coroutine_handle<SatTerm_Task::promise_type> handle);
+	std::unique_ptr<SatTerm_Server> await_resume(void);
+	
+	std::function<std::unique_ptr<SatTerm_Server>(void)> connect;
+	std::unique_ptr<SatTerm_Server> server;
+	std::thread connect_thread = {};
+};
+
+// Single-threaded event loop that multiplexes any number of tasks, across any number of agents, over their Ports' fifo descriptors.
+class SatTerm_Loop {
+	public:
+		SatTerm_Loop();
+		~SatTerm_Loop();
+		
+		void Spawn(SatTerm_Task task);
+		size_t Run(void);
+		size_t RunFor(satterm_duration duration);
+		size_t RunUntil(satterm_deadline deadline);
+		void Stop(void);
+		size_t GetTaskCount(void);
+		error_descriptor GetErrorCode(void);
+		
+		bool Watch(satterm_async_operation* operation);
+	
+	private:
+		void Unwatch(satterm_async_operation* operation);
+		uint32_t GetWatchedEvents(int descriptor);
+		void ResumeScheduled(void);
+		
+		int m_epoll_descriptor = -1;
+		std::vector<std::coroutine_handle<SatTerm_Task::promise_type>> m_tasks = {};
+		std::vector<std::coroutine_handle<>> m_scheduled = {};
+		std::vector<satterm_async_operation*> m_operations = {};
+		std::vector<satterm_async_operation*> m_ready_operations = {};
+		error_state m_error = {error_type::none, 0};
+		bool m_stop = false;
+};
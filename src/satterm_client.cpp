@@ -14,6 +14,8 @@
 #include <string>                     // std::string, std::stoi.
 #include <map>                        // std::map.
 #include <vector>                     // std::vector.
+#include <chrono>                     // std::chrono::seconds, std::chrono::milliseconds.
+#include <cstdlib>                    // strtoull().
 
 #include "satellite_terminal.h"
 
@@ -34,6 +36,18 @@ SatTerm_Client::SatTerm_Client(std::string const& identifier, int argc, char* ar
 		m_stop_message = std::string(argv[argv_start_index + 2]);
 		port_count = std::stoi(std::string(argv[argv_start_index + 3]));
 		port_identifiers = ParseFifoPaths(argv_start_index + 4, port_count, argv);
+		
+		// Options the server may append after the Port identifiers. A client started by hand without them waits 5 seconds for the session handshake.
+		port_options options;
+		satterm_duration timeout = std::chrono::seconds(5);
+		for (size_t i = argv_start_index + 4 + port_count; i < (size_t)(argc); i ++) {
+			std::string option = argv[i];
+			if (option == "seqpacket") {
+				options.transport = transport_mode::seqpacket;
+			} else if (option.compare(0, 11, "timeout_ms=") == 0) {
+				timeout = std::chrono::milliseconds(strtoull(option.c_str() + 11, NULL, 10));
+			}
+		}
 
 		m_default_port_identifier = port_identifiers[0];
 		
@@ -42,7 +56,10 @@ SatTerm_Client::SatTerm_Client(std::string const& identifier, int argc, char* ar
 			std::cerr << message << std::endl;
 		}
 		
-		success = CreatePorts(false, m_working_path, port_identifiers, m_display_messages, m_end_char, m_ports);
+		success = CreatePorts(false, m_working_path, port_identifiers, m_display_messages, m_end_char, options, m_ports);
+		if (success) {
+			success = OpenSession(false, Port::DeadlineAfter(timeout), options);
+		}
 		
 		if (success) {
 			if (m_display_messages) {
@@ -56,7 +73,7 @@ SatTerm_Client::SatTerm_Client(std::string const& identifier, int argc, char* ar
 			}
 		}
 	} else {
-		m_error_code = {-1, "GetArgStartIndex()_invalid_args"};
+		m_error = {error_type::invalid_args, -1};
 		if (m_display_messages) {
 			std::string error_message = "GetArgStartIndex() found invalid client configuration arguments.";
 			std::cerr << error_message << std::endl;
@@ -0,0 +1,246 @@
+// -----------------------------------------------------------------------------------------------------
+// satellite_terminal - Easily spawn and communicate bidirectionally with client processes in separate
+//                      terminal emulator instances.
+// -----------------------------------------------------------------------------------------------------
+// seb.nf.sikora@protonmail.com
+//
+// Copyright © 2021 Dr Seb N.F. Sikora.
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+// -----------------------------------------------------------------------------------------------------
+
+#include <iostream>                   // std::cerr, std::endl.
+#include <string>                     // std::string.
+#include <vector>                     // std::vector.
+#include <deque>                      // std::deque.
+#include <cstdint>                    // uint64_t, SIZE_MAX.
+#include <algorithm>                  // std::min.
+#include <chrono>                     // std::chrono::milliseconds.
+
+#include "satellite_terminal.h"
+
+// How long GetResults() waits for results before it tries again to send the rest of a part-sent work item.
+static const satterm_duration OWED_RETRY_WAIT = std::chrono::milliseconds(1);
+
+SatTerm_Dispatcher::SatTerm_Dispatcher(SatTerm_Pool& pool, std::string const& port_identifier, dispatch_policy policy) : m_pool(pool) {
+	// Work items are sent to, and results received from, the Port named port_identifier of each of the pool's clients. Each client must
+	// answer every work item it receives with exactly one message, in the order it received them. Its other Ports are left to the caller.
+	m_policy = policy;
+	m_outstanding.resize(m_pool.GetClientCount());
+	m_owed.resize(m_pool.GetClientCount());
+	// One handle serves every client, so it must resolve to the same Port on each. Clients that did not connect are never sent work, and
+	// may have no Ports at all, so they are left out.
+	m_port_valid = true;
+	bool port_resolved = false;
+	for (size_t i = 0; i < m_pool.GetClientCount(); i ++) {
+		SatTerm_Server* client = m_pool.GetClient(i);
+		if (!client->IsConnected()) {
+			continue;
+		}
+		port_handle port = client->GetPortHandle(port_identifier);
+		if (client->GetErrorState().type != error_type::none) {
+			m_error = client->GetErrorState();
+			m_port_valid = false;
+			break;
+		}
+		if (port_resolved && (port != m_port)) {
+			m_error = {error_type::oor_port_id, -1, "SatTerm_Dispatcher()"};
+			std::cerr << "SatTerm_Dispatcher() error - Port " << port_identifier << " has a different handle on client " << i << std::endl;
+			m_port_valid = false;
+			break;
+		}
+		m_port = port;
+		port_resolved = true;
+	}
+}
+
+void SatTerm_Dispatcher::SetPolicy(dispatch_policy policy) {
+	m_policy = policy;
+}
+
+dispatch_policy SatTerm_Dispatcher::GetPolicy(void) {
+	return m_policy;
+}
+
+uint64_t SatTerm_Dispatcher::Submit(std::string const& work_item, unsigned long timeout_seconds) {
+	return Submit(work_item, Port::SecondsToDuration(timeout_seconds));
+}
+
+uint64_t SatTerm_Dispatcher::Submit(std::string const& work_item, satterm_duration timeout) {
+	return Submit(work_item, Port::DeadlineAfter(timeout));
+}
+
+uint64_t SatTerm_Dispatcher::Submit(std::string const& work_item, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
+	
+	// Sends the work item to the client chosen by the policy. Returns the job number with which its result will be reported, or 0 if the
+	// dispatcher's Port does not exist, no client is connected, or the work item could not be sent (GetErrorCode() then says why). A work
+	// item only partly sent by the deadline still gets its job number, with GetErrorCode() saying why it was cut short. The rest of it is
+	// owed, and is sent before anything else goes to that client, as a frame left part-sent would otherwise swallow the next work item.
+	if (!m_port_valid) {
+		m_error = {error_type::oor_port_id, -1, "Submit()"};
+		return 0;
+	}
+	size_t client_index = SelectClient();
+	if (client_index >= m_pool.GetClientCount()) {
+		m_error = {error_type::no_connected_client, 0};
+		return 0;
+	}
+	if (!SendOwed(client_index, deadline)) {
+		return 0;
+	}
+	SatTerm_Server* client = m_pool.GetClient(client_index);
+	std::string remaining_message = client->SendMessage(work_item, m_port, deadline);
+	if (!client->IsConnected()) {
+		m_error = client->GetErrorState();
+		return 0;
+	}
+	if (remaining_message != "") {
+		m_error = client->GetErrorState();
+		m_owed[client_index] = std::move(remaining_message);
+	}
+	uint64_t job = m_next_job ++;
+	m_outstanding[client_index].push_back(job);
+	return job;
+}
+
+bool SatTerm_Dispatcher::SendOwed(size_t client, satterm_deadline deadline) {
+	// Sends whatever is owed of a part-sent work item to the client with index client, including an end char left unsent after the rest
+	// of it went out. Returns true once nothing is owed.
+	SatTerm_Server* target = m_pool.GetClient(client);
+	if (!m_owed[client].empty()) {
+		m_owed[client] = target->SendMessage(m_owed[client], m_port, deadline);
+		if (!m_owed[client].empty() || !target->IsConnected()) {
+			m_error = target->GetErrorState();
+			return false;
+		}
+	}
+	if (!target->FlushTx(m_port, deadline) || !target->IsConnected()) {
+		m_error = target->GetErrorState();
+		return false;
+	}
+	return true;
+}
+
+size_t SatTerm_Dispatcher::GetResults(std::vector<dispatch_result>& results, size_t max_count, unsigned long timeout_seconds) {
+	return GetResults(results, max_count, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Dispatcher::GetResults(std::vector<dispatch_result>& results, size_t max_count, satterm_duration timeout) {
+	return GetResults(results, max_count, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Dispatcher::GetResults(std::vector<dispatch_result>& results, size_t max_count, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
+	
+	// Waits until at least one result has come back (or the deadline passes), then returns every result available, up to max_count (0 for
+	// no limit). The results arriving from a client are matched, in order, to the jobs at the front of its queue. The jobs of a client that
+	// has disconnected are all reported at once, as not completed. Returns immediately if there are no jobs outstanding.
+	results.clear();
+	if (max_count == 0) {
+		max_count = SIZE_MAX;
+	}
+	for (size_t i = 0; i < m_outstanding.size(); i ++) {
+		if (!m_outstanding[i].empty() && !m_pool.GetClient(i)->IsConnected()) {
+			AbandonJobs(i, results);
+		}
+	}
+	
+	while ((results.size() == 0) && (GetOutstandingCount() > 0)) {
+		// A part-sent work item cannot be answered until the rest of it (or just its end char) is sent, so while any is owed the wait is
+		// cut short to retry.
+		satterm_deadline wait_deadline = deadline;
+		for (size_t i = 0; i < m_owed.size(); i ++) {
+			if (!m_outstanding[i].empty() && m_pool.GetClient(i)->IsConnected() && !SendOwed(i, satterm_deadline())) {
+				wait_deadline = std::min(deadline, Port::DeadlineAfter(OWED_RETRY_WAIT));
+			}
+		}
+		m_error = {error_type::none, 0};
+		m_pool.GetReadyPorts(m_ready_ports, m_port, wait_deadline);
+		if (m_pool.GetErrorState().type != error_type::none) {
+			m_error = m_pool.GetErrorState();
+			break;
+		}
+		for (size_t i = 0; (i < m_ready_ports.size()) && (results.size() < max_count); i ++) {
+			size_t client_index = m_ready_ports[i].client;
+			SatTerm_Server* client = m_pool.GetClient(client_index);
+			size_t message_count = client->GetMessages(m_port, m_messages, max_count - results.size(), false, satterm_deadline());
+			for (size_t j = 0; j < message_count; j ++) {
+				uint64_t job = 0;
+				if (!m_outstanding[client_index].empty()) {
+					job = m_outstanding[client_index].front();
+					m_outstanding[client_index].pop_front();
+				}
+				results.push_back({job, client_index, true, std::move(m_messages[j])});
+			}
+			if (!client->IsConnected()) {
+				AbandonJobs(client_index, results);
+			}
+		}
+		if (satterm_clock::now() >= deadline) {
+			break;
+		}
+	}
+	return results.size();
+}
+
+size_t SatTerm_Dispatcher::GetOutstandingCount(void) {
+	size_t outstanding_count = 0;
+	for (auto const& jobs : m_outstanding) {
+		outstanding_count += jobs.size();
+	}
+	return outstanding_count;
+}
+
+size_t SatTerm_Dispatcher::GetOutstandingCount(size_t client) {
+	// Returns the number of work items sent to the client with index client and not yet answered, or 0 if the index is out of range.
+	return (client < m_outstanding.size()) ? m_outstanding[client].size() : 0;
+}
+
+size_t SatTerm_Dispatcher::SelectClient(void) {
+	// Returns the index of the connected client to send the next work item to, or the client count if none is connected. The search starts
+	// after the client chosen last, so that round_robin takes each in turn and the other policies share ties out evenly.
+	size_t client_count = m_pool.GetClientCount();
+	size_t selected = client_count;
+	size_t selected_load = 0;
+	size_t selected_outstanding = 0;
+	for (size_t n = 0; n < client_count; n ++) {
+		size_t i = (m_next_client + n) % client_count;
+		SatTerm_Server* client = m_pool.GetClient(i);
+		if (!client->IsConnected()) {
+			continue;
+		}
+		if (m_policy == dispatch_policy::round_robin) {
+			selected = i;
+			break;
+		}
+		size_t outstanding = m_outstanding[i].size();
+		size_t load = (m_policy == dispatch_policy::least_occupied) ? client->GetUnreadBytes(m_port) : outstanding;
+		if ((selected == client_count) || (load < selected_load) || ((load == selected_load) && (outstanding < selected_outstanding))) {
+			selected = i;
+			selected_load = load;
+			selected_outstanding = outstanding;
+		}
+	}
+	if (selected < client_count) {
+		m_next_client = (selected + 1) % client_count;
+	}
+	return selected;
+}
+
+void SatTerm_Dispatcher::AbandonJobs(size_t client, std::vector<dispatch_result>& results) {
+	for (uint64_t job : m_outstanding[client]) {
+		results.push_back({job, client, false, ""});
+	}
+	m_outstanding[client].clear();
+	m_owed[client].clear();
+}
+
+error_descriptor SatTerm_Dispatcher::GetErrorCode(void) {
+	return Port::DescribeError(m_error);
+}
+
+error_state SatTerm_Dispatcher::GetErrorState(void) {
+	return m_error;
+}
@@ -0,0 +1,374 @@
+// -----------------------------------------------------------------------------------------------------
+// satellite_terminal - Easily spawn and communicate bidirectionally with client processes in separate
+//                      terminal emulator instances.
+// -----------------------------------------------------------------------------------------------------
+// seb.nf.sikora@protonmail.com
+//
+// Copyright © 2021 Dr Seb N.F. Sikora.
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+// -----------------------------------------------------------------------------------------------------
+
+#include <string>                     // std::string.
+#include <string_view>                // std::string_view.
+#include <vector>                     // std::vector.
+#include <memory>                     // std::unique_ptr, std::make_unique.
+#include <atomic>                     // std::atomic, std::atomic_thread_fence.
+#include <thread>                     // std::thread.
+#include <system_error>               // std::system_error.
+#include <chrono>                     // std::chrono::duration_cast.
+
+#include <errno.h>                    // errno.
+#include <stdint.h>                   // uint32_t, uint64_t.
+#include <time.h>                     // struct timespec.
+#include <unistd.h>                   // read(), write().
+#include <poll.h>                     // poll(), struct pollfd.
+#include <sys/eventfd.h>              // eventfd().
+
+#include "satellite_terminal.h"
+
+// While the I/O thread is running it alone calls into the Ports. The application thread only ever touches each Port's io_port queues,
+// so sends return as soon as the message is queued and receives return whatever the I/O thread has already read, regardless of how
+// quickly the counterpart drains or fills its fifos.
+//
+// Each side sleeps when it has nothing to do, the I/O thread in poll() on an eventfd and application threads on a futex, as several of
+// them may be waiting at once and each must be woken. A side only wakes the other when the other has flagged that it is (about to be)
+// asleep, so in steady state queueing a message costs no system call.
+
+bool SatTerm_Agent::StartIoThread(size_t queue_capacity) {
+	m_error = {error_type::none, 0};
+	
+	if (m_io_running) {
+		return true;
+	}
+	if (m_io_event_descriptor < 0) {
+		m_io_event_descriptor = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	}
+	if (m_io_event_descriptor < 0) {
+		m_error = {error_type::eventfd, errno};
+		return false;
+	}
+	
+	// If the I/O thread has run before, keep its queues so that any inbound messages not yet collected are still delivered in order.
+	if (m_io_ports.size() != m_ports.size()) {
+		m_io_ports.clear();
+		for (auto const& port : m_ports) {
+			std::unique_ptr<io_port> io = std::make_unique<io_port>(queue_capacity);
+			io->opened = port->IsOpened();
+			io->error = port->GetErrorState();
+			m_io_ports.push_back(std::move(io));
+		}
+	}
+	
+	m_io_stop = false;
+	try {
+		m_io_thread = std::thread(&SatTerm_Agent::RunIoThread, this);
+	}
+	
+	catch (const std::system_error& system_error) {
+		m_error = {error_type::io_thread, system_error.code().value()};
+		return false;
+	}
+	m_io_running = true;
+	return true;
+}
+
+void SatTerm_Agent::StopIoThread(void) {
+	// The I/O thread makes one last attempt to send everything still queued before it exits. Inbound messages it has already read stay
+	// queued and are returned by the following GetMessage() calls before any more are read from the fifo directly.
+	if (m_io_running) {
+		m_io_stop = true;
+		RingEvent(m_io_event_descriptor);
+		m_io_thread.join();
+		m_io_running = false;
+	}
+}
+
+bool SatTerm_Agent::IsIoThreadRunning(void) {
+	return m_io_running;
+}
+
+void SatTerm_Agent::RunIoThread(void) {
+	std::vector<struct pollfd> descriptors = {};
+	
+	while (!m_io_stop.load()) {
+		bool activity = false;
+		for (size_t i = 0; i < m_io_ports.size(); i ++) {
+			activity |= ServiceIoPort(i, satterm_deadline());
+		}
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (activity) {
+			if (m_app_waiting.load() > 0) {
+				m_app_wake_sequence.fetch_add(1);
+				FutexWake(m_app_wake_sequence);
+			}
+			continue;               // Go round again until there is nothing more that can be done without blocking.
+		}
+		
+		descriptors.clear();
+		descriptors.push_back({m_io_event_descriptor, POLLIN, 0});
+		for (size_t i = 0; i < m_io_ports.size(); i ++) {
+			io_port& io = *(m_io_ports[i]);
+			bool rx_blocked = (io.error_pending || io.inbound.IsFull());
+			io.rx_blocked.store(rx_blocked);
+			if (!io.opened.load()) {
+				continue;
+			}
+			if (io.tx_in_flight) {
+				descriptors.push_back({m_ports[i]->GetTxDescriptor(), POLLOUT, 0});
+			}
+			if (!rx_blocked) {
+				descriptors.push_back({m_ports[i]->GetRxDescriptor(), POLLIN, 0});
+			}
+		}
+		
+		m_io_waiting.store(true);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		
+		// Re-check for work that was queued before m_io_waiting was set, as the application thread will not have rung for it.
+		bool work_queued = m_io_stop.load();
+		for (size_t i = 0; i < m_io_ports.size(); i ++) {
+			io_port& io = *(m_io_ports[i]);
+			if (io.opened.load() && !io.tx_in_flight && !io.outbound.IsEmpty()) {
+				work_queued = true;
+			}
+			if (io.rx_blocked.load() && !io.inbound.IsFull()) {
+				work_queued = true;
+			}
+			if (io.opened.load() && !io.rx_blocked.load() && m_ports[i]->PrepareRxWait()) {
+				work_queued = true;
+			}
+		}
+		if (!work_queued) {
+			poll(descriptors.data(), descriptors.size(), -1);
+		}
+		m_io_waiting.store(false);
+		
+		uint64_t event_count = 0;
+		ssize_t status = read(m_io_event_descriptor, &event_count, sizeof(event_count));
+		(void)(status);
+	}
+	
+	satterm_deadline flush_deadline = Port::DeadlineAfter(std::chrono::seconds(1));
+	for (size_t i = 0; i < m_io_ports.size(); i ++) {
+		ServiceIoPort(i, flush_deadline);
+	}
+}
+
+bool SatTerm_Agent::ServiceIoPort(size_t port_index, satterm_deadline tx_deadline) {
+	// Moves as many messages as possible between a Port's queues and its fifos, blocking on the tx fifo only until tx_deadline. Returns
+	// true if anything was moved.
+	io_port& io = *(m_io_ports[port_index]);
+	Port* port = m_ports[port_index].get();
+	bool activity = false;
+	
+	while (io.opened.load(std::memory_order_relaxed)) {
+		if (!io.tx_in_flight) {
+			if (!io.outbound.Pop(io.tx_item)) {
+				break;
+			}
+			io.tx_in_flight = true;
+			io.tx_offset = 0;
+			activity = true;
+		}
+		
+		bool sent = false;
+		if (io.tx_framing_owed) {
+			sent = port->FlushTx(tx_deadline);
+		} else if (io.tx_item.raw_bytes) {
+			io.tx_offset += port->SendBytes(io.tx_item.message.data() + io.tx_offset, io.tx_item.message.size() - io.tx_offset, tx_deadline);
+			sent = (io.tx_offset == io.tx_item.message.size());
+		} else {
+			std::string remaining_message = port->SendMessage(io.tx_item.message, tx_deadline);
+			sent = (remaining_message.size() == 0);
+			if (!sent) {
+				io.tx_item.message.swap(remaining_message);         // The Port carries the frame over to the next SendMessage() call.
+			}
+		}
+		
+		error_state error = port->GetErrorState();
+		if ((error.type == error_type::write_thread_block) || (error.type == error_type::write_thread_block_timeout)) {
+			io.tx_framing_owed |= sent;                                 // Resending the (empty) remainder would frame an extra message.
+			break;                                                      // The fifo is full. Wait for POLLOUT.
+		} else if (error.type != error_type::none) {
+			FailIoPort(io, error);
+			break;
+		}
+		if (sent) {
+			io.tx_in_flight = false;
+			io.tx_framing_owed = false;
+		}
+	}
+	
+	if (io.error_pending) {
+		io.rx_item.message.clear();
+		io.rx_item.error = io.error;
+		if (io.inbound.Push(io.rx_item)) {
+			io.error_pending = false;
+			activity = true;
+		}
+		io.rx_item.error = {error_type::none, 0};
+	}
+	
+	if (io.opened.load(std::memory_order_relaxed)) {
+		size_t message_count = port->GetMessages(io.rx_messages, io.inbound.GetFreeCount(), false, satterm_deadline());
+		for (size_t i = 0; i < message_count; i ++) {
+			io.rx_item.message.swap(io.rx_messages[i]);
+			io.rx_item.error = {error_type::none, 0};
+			io.inbound.Push(io.rx_item);
+			io.rx_messages[i].swap(io.rx_item.message);             // Hand the spent buffer back for GetMessages() to reuse.
+		}
+		activity |= (message_count > 0);
+		
+		error_state error = port->GetErrorState();
+		if (error.type != error_type::none) {
+			FailIoPort(io, error);
+			activity = true;
+		}
+	}
+	return activity;
+}
+
+void SatTerm_Agent::FailIoPort(io_port& io, error_state const& error) {
+	// The error is reported to the application thread as an inbound queue entry, after any messages received before it.
+	io.error = error;
+	io.opened.store(false);
+	io.tx_in_flight = false;
+	io.tx_framing_owed = false;
+	io.error_pending = true;
+}
+
+bool SatTerm_Agent::ReceiveQueuedMessage(port_handle port, bool capture_end_char, satterm_deadline deadline) {
+	// Pops the next message from the Port's inbound queue into its app_rx_item, waiting until deadline for one to arrive only if the I/O
+	// thread is running. Returns false if no message was popped, or if the queue instead reported that the Port has failed.
+	io_port& io = *(m_io_ports[port.index]);
+	satterm_deadline start_time = satterm_clock::now();
+	
+	bool popped = io.inbound.Pop(io.app_rx_item);
+	if (!popped && m_io_running) {
+		if (!io.opened.load()) {
+			m_error = io.error;
+			SetConnectedFlag(false);
+			return false;
+		}
+		if (deadline > start_time) {
+			m_app_waiting.fetch_add(1);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			uint32_t wake_sequence = m_app_wake_sequence.load();
+			while (!(popped = io.inbound.Pop(io.app_rx_item)) && (satterm_clock::now() < deadline)) {
+				WaitForIoThread(wake_sequence, deadline);
+				wake_sequence = m_app_wake_sequence.load();
+			}
+			m_app_waiting.fetch_sub(1);
+			if (!popped) {
+				m_error = {error_type::tx_conn_timeout, EAGAIN};
+			}
+		}
+	}
+	if (!popped) {
+		return false;
+	}
+	
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (io.rx_blocked.load() && m_io_waiting.load()) {
+		RingEvent(m_io_event_descriptor);                // The I/O thread stopped reading because the queue was full. There is room now.
+	}
+	if (io.app_rx_item.error.type != error_type::none) {
+		m_error = io.app_rx_item.error;
+		SetConnectedFlag(false);
+		return false;
+	}
+	if (capture_end_char && (m_ports[port.index]->GetFramingMode() == framing_mode::end_char)) {
+		io.app_rx_item.message.push_back(m_end_char);
+	}
+	return true;
+}
+
+bool SatTerm_Agent::SendQueuedMessage(port_handle port, std::string_view const* message_parts, size_t part_count, bool raw_bytes,
+                                      satterm_deadline deadline) {
+	// Queues the concatenation of message_parts for the I/O thread to send, waiting until deadline for room in the queue if it is full.
+	io_port& io = *(m_io_ports[port.index]);
+	if (!io.opened.load()) {
+		m_error = io.error;
+		SetConnectedFlag(false);
+		return false;
+	}
+	
+	io.app_tx_lock.Lock();
+	io.app_tx_item.message.clear();
+	for (size_t i = 0; i < part_count; i ++) {
+		io.app_tx_item.message.append(message_parts[i]);
+	}
+	io.app_tx_item.raw_bytes = raw_bytes;
+	io.app_tx_item.error = {error_type::none, 0};
+	
+	bool pushed = io.outbound.Push(io.app_tx_item);
+	if (!pushed && (deadline > satterm_clock::now())) {
+		m_app_waiting.fetch_add(1);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		uint32_t wake_sequence = m_app_wake_sequence.load();
+		while (!(pushed = io.outbound.Push(io.app_tx_item)) && (satterm_clock::now() < deadline)) {
+			WaitForIoThread(wake_sequence, deadline);
+			wake_sequence = m_app_wake_sequence.load();
+		}
+		m_app_waiting.fetch_sub(1);
+	}
+	io.app_tx_lock.Unlock();
+	if (!pushed) {
+		m_error = {error_type::tx_queue_full, EAGAIN};
+		return false;
+	}
+	
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_io_waiting.load()) {
+		RingEvent(m_io_event_descriptor);
+	}
+	return true;
+}
+
+size_t SatTerm_Agent::GetQueuedReadyPorts(std::vector<port_handle>& ready_ports, satterm_deadline deadline, bool writable) {
+	// As GetReadyPorts(), but judged by the state of the queues rather than the fifos.
+	m_app_waiting.fetch_add(1);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	
+	bool finished = false;
+	while (!finished) {
+		uint32_t wake_sequence = m_app_wake_sequence.load();
+		for (size_t i = 0; i < m_io_ports.size(); i ++) {
+			io_port& io = *(m_io_ports[i]);
+			bool ready = writable ? (io.opened.load() && !io.outbound.IsFull()) : !io.inbound.IsEmpty();
+			if (ready) {
+				ready_ports.push_back({i});
+			}
+		}
+		if ((ready_ports.size() > 0) || (satterm_clock::now() >= deadline)) {
+			finished = true;
+		} else {
+			WaitForIoThread(wake_sequence, deadline);
+		}
+	}
+	m_app_waiting.fetch_sub(1);
+	return ready_ports.size();
+}
+
+void SatTerm_Agent::WaitForIoThread(uint32_t wake_sequence, satterm_deadline deadline) {
+	// Sleeps until the I/O thread has bumped m_app_wake_sequence past wake_sequence (read before the caller last checked its queue) or the
+	// deadline passes. The caller must already have set m_app_waiting.
+	satterm_duration remaining = deadline - satterm_clock::now();
+	if (remaining <= satterm_duration::zero()) {
+		return;
+	}
+	if (remaining > std::chrono::seconds(60)) {
+		remaining = std::chrono::seconds(60);
+	}
+	long long remaining_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(remaining).count();
+	struct timespec timeout = {(time_t)(remaining_ns / 1000000000), (long)(remaining_ns % 1000000000)};
+	FutexWait(m_app_wake_sequence, wake_sequence, &timeout);
+}
+
+void SatTerm_Agent::RingEvent(int event_descriptor) {
+	uint64_t event_count = 1;
+	ssize_t status = write(event_descriptor, &event_count, sizeof(event_count));
+	(void)(status);
+}
@@ -0,0 +1,477 @@
+// -----------------------------------------------------------------------------------------------------
+// satellite_terminal - Easily spawn and communicate bidirectionally with client processes in separate
+//                      terminal emulator instances.
+// -----------------------------------------------------------------------------------------------------
+// seb.nf.sikora@protonmail.com
+//
+// Copyright © 2021 Dr Seb N.F. Sikora.
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+// -----------------------------------------------------------------------------------------------------
+
+#include <iostream>                   // std::cerr, std::endl.
+#include <string>                     // std::string, std::to_string.
+#include <vector>                     // std::vector.
+#include <memory>                     // std::unique_ptr.
+#include <algorithm>                  // std::find.
+#include <chrono>                     // std::chrono::ceil.
+
+#include <errno.h>                    // errno.
+#include <stdio.h>                    // perror(), FILENAME_MAX.
+#include <unistd.h>                   // close(), getcwd(), rmdir().
+#include <sys/stat.h>                 // mkdir(), stat().
+#include <sys/epoll.h>                // epoll_create1(), epoll_ctl(), epoll_wait().
+
+#include "satellite_terminal.h"
+
+SatTerm_Pool::SatTerm_Pool(std::string const& identifier, std::string const& path_to_client_binary, size_t client_count, bool display_messages,
+                           std::vector<std::string> port_identifiers, std::string const& stop_message,
+                           std::string const& path_to_terminal_emulator_paths, char end_char,
+                           satterm_duration timeout, port_options const& options, launch_options const& launch) {
+	m_identifier = identifier;
+	m_display_messages = display_messages;
+	if (port_identifiers.size() == 0) {                             // As each SatTerm_Server would, so that the pool watches the same Ports.
+		port_identifiers.push_back("comms");
+	}
+	m_port_identifiers = port_identifiers;
+	
+	// Each client's fifos are created in a directory of its own (identifier_n/ in the working path), so that every client can use the same
+	// Port identifiers without their fifos or socket names colliding.
+	std::string base_directory = launch.fifo_directory;
+	if (base_directory == "") {
+		char working_path[FILENAME_MAX + 1];
+		if (getcwd(working_path, FILENAME_MAX + 1) == NULL) {
+			m_error = {error_type::getcwd, errno};
+			if (m_display_messages) {
+				perror("getcwd() unable to obtain current working path");
+			}
+			return;
+		}
+		base_directory = std::string(working_path);
+	}
+	if (base_directory.back() != '/') {
+		base_directory += "/";
+	}
+	
+	// Every client is started before any handshake is awaited, so that the clients all open their Ports side by side, and the handshakes
+	// are then completed from this thread as each client's hello arrives.
+	std::vector<size_t> launched = {};
+	for (size_t i = 0; i < client_count; i ++) {
+		std::string client_identifier = m_identifier + "_" + std::to_string(i);
+		launch_options client_launch = launch;
+		client_launch.fifo_directory = base_directory + client_identifier + "/";
+		m_clients.push_back(std::unique_ptr<SatTerm_Server>(new SatTerm_Server()));
+		SatTerm_Server& client = *m_clients.back();
+		bool success = false;
+		struct stat directory_status = {};
+		if ((mkdir(client_launch.fifo_directory.c_str(), 0700) < 0) &&
+		    ((errno != EEXIST) || (stat(client_launch.fifo_directory.c_str(), &directory_status) < 0) || !S_ISDIR(directory_status.st_mode))) {
+			if (errno == EEXIST) {
+				errno = ENOTDIR;                                    // Something other than a directory is in the way.
+			}
+			// The client is not started, and its own error (as well as the pool's) says why.
+			client.m_identifier = client_identifier;
+			client.m_error = {error_type::mkdir, errno};
+			m_error = client.GetErrorState();
+			if (m_display_messages) {
+				std::string error_message = "Pool " + m_identifier + " unable to create fifo directory " + client_launch.fifo_directory;
+				perror(error_message.c_str());
+			}
+		} else {
+			m_fifo_directories.push_back(client_launch.fifo_directory);
+			success = client.Launch(client_identifier, path_to_client_binary, display_messages, port_identifiers, stop_message,
+			                        path_to_terminal_emulator_paths, end_char, "", timeout, options, client_launch);
+		}
+		if (success) {
+			launched.push_back(i);
+		} else {
+			client.FinishConnecting(false);
+		}
+	}
+	AcceptSessions(launched, options, Port::DeadlineAfter(timeout));
+	
+	if (m_display_messages) {
+		std::string message = "Pool " + m_identifier + " connected " + std::to_string(GetConnectedCount()) + " of " + std::to_string(client_count) + " clients.";
+		std::cerr << message << std::endl;
+	}
+}
+
+void SatTerm_Pool::AcceptSessions(std::vector<size_t> const& launched, port_options const& options, satterm_deadline deadline) {
+	// Waits on the session Port of every launched client with a single epoll instance. Once a client's whole hello has arrived (or it has
+	// hung up), its handshake completes without waiting, as the client has already opened its ends of every Port.
+	int epoll_descriptor = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_descriptor < 0) {
+		m_error = {error_type::epoll_create1, errno};
+	}
+	size_t pending_count = 0;
+	for (size_t i : launched) {
+		struct epoll_event event = {};
+		event.events = EPOLLIN;
+		event.data.u64 = i;
+		if ((epoll_descriptor >= 0) && (epoll_ctl(epoll_descriptor, EPOLL_CTL_ADD, m_clients[i]->m_session_port->GetRxDescriptor(), &event) == 0)) {
+			pending_count ++;
+		}
+	}
+	
+	const int max_events = 64;
+	struct epoll_event events[max_events];
+	while ((pending_count > 0) && (satterm_clock::now() < deadline)) {
+		int timeout_ms = 0;
+		satterm_duration remaining = deadline - satterm_clock::now();
+		if (remaining > satterm_duration::zero()) {
+			long long remaining_ms = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+			timeout_ms = (remaining_ms < 60000) ? (int)(remaining_ms) : 60000;
+		}
+		
+		int event_count = epoll_wait(epoll_descriptor, events, max_events, timeout_ms);
+		
+		if ((event_count < 0) && (errno != EINTR)) {
+			m_error = {error_type::epoll_wait, errno};
+			break;
+		}
+		for (int i = 0; i < event_count; i ++) {
+			SatTerm_Server& client = *m_clients[events[i].data.u64];
+			if (!(events[i].events & (EPOLLHUP | EPOLLERR)) && !client.m_session_port->IsMessageReady()) {
+				continue;                                           // Only part of the hello has arrived.
+			}
+			epoll_ctl(epoll_descriptor, EPOLL_CTL_DEL, client.m_session_port->GetRxDescriptor(), NULL);
+			client.FinishConnecting(client.OpenSession(true, deadline, options));
+			pending_count --;
+		}
+	}
+	if (epoll_descriptor >= 0) {
+		close(epoll_descriptor);
+	}
+	
+	// Whichever clients are left have timed out (or could not be watched), which OpenSession() reports once the deadline has passed.
+	for (size_t i : launched) {
+		if (m_clients[i]->m_session_port) {
+			m_clients[i]->FinishConnecting(m_clients[i]->OpenSession(true, deadline, options));
+		}
+	}
+}
+
+void SatTerm_Pool::StopClients(satterm_deadline deadline) {
+	// As ~SatTerm_Server(), but for every client at once. Each connected client is sent its stop message, and then all of their
+	// confirmations are awaited together with a single epoll instance, so that stopping the pool takes about as long as the slowest client
+	// rather than the sum of them all. Afterwards no client counts as connected, so that destroying them does not wait for them again.
+	int epoll_descriptor = epoll_create1(EPOLL_CLOEXEC);
+	std::vector<std::string> messages = {};
+	size_t stopping_count = 0;
+	for (size_t i = 0; i < m_clients.size(); i ++) {
+		SatTerm_Server& client = *m_clients[i];
+		if (!client.IsConnected()) {
+			continue;
+		}
+		port_handle stop_port = client.GetPortHandle(client.m_stop_port_identifier);
+		client.SendMessage(client.m_stop_message, stop_port, deadline);
+		if (ReceiveStopConfirmation(client, stop_port, messages)) {
+			continue;
+		}
+		struct epoll_event event = {};
+		event.events = EPOLLIN;
+		event.data.u64 = i;
+		if ((epoll_descriptor >= 0) && (epoll_ctl(epoll_descriptor, EPOLL_CTL_ADD, client.m_ports[stop_port.index]->GetRxDescriptor(), &event) == 0)) {
+			stopping_count ++;
+		}
+	}
+	if ((stopping_count > 0) && m_display_messages) {
+		std::cerr << "Waiting for client processes to terminate..." << std::endl;
+	}
+	
+	const int max_events = 64;
+	struct epoll_event events[max_events];
+	while ((stopping_count > 0) && (satterm_clock::now() < deadline)) {
+		int timeout_ms = 0;
+		satterm_duration remaining = deadline - satterm_clock::now();
+		if (remaining > satterm_duration::zero()) {
+			long long remaining_ms = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+			timeout_ms = (remaining_ms < 60000) ? (int)(remaining_ms) : 60000;
+		}
+		
+		int event_count = epoll_wait(epoll_descriptor, events, max_events, timeout_ms);
+		
+		if ((event_count < 0) && (errno != EINTR)) {
+			break;
+		}
+		for (int i = 0; i < event_count; i ++) {
+			SatTerm_Server& client = *m_clients[events[i].data.u64];
+			port_handle stop_port = client.GetPortHandle(client.m_stop_port_identifier);
+			if (ReceiveStopConfirmation(client, stop_port, messages)) {
+				epoll_ctl(epoll_descriptor, EPOLL_CTL_DEL, client.m_ports[stop_port.index]->GetRxDescriptor(), NULL);
+				stopping_count --;
+			}
+		}
+	}
+	if (epoll_descriptor >= 0) {
+		close(epoll_descriptor);
+	}
+	for (auto& client : m_clients) {
+		client->SetConnectedFlag(false);
+	}
+}
+
+bool SatTerm_Pool::ReceiveStopConfirmation(SatTerm_Server& client, port_handle stop_port, std::vector<std::string>& messages) {
+	// Receives whatever has already arrived on the client's stop Port. Returns true once the client has confirmed that it is stopping (by
+	// echoing the stop message), or has disconnected.
+	while (client.IsConnected() && (client.GetMessages(stop_port, messages, 1, false, satterm_deadline()) > 0)) {
+		if (messages[0] == client.m_stop_message) {
+			return true;
+		}
+	}
+	return !client.IsConnected();
+}
+
+SatTerm_Pool::~SatTerm_Pool() {
+	StopClients(Port::DeadlineAfter(std::chrono::seconds(5)));
+	
+	// Every client's Ports are closed before any client process is waited for, so that they all exit side by side, and then they are all
+	// reaped against the one deadline.
+	for (auto& client : m_clients) {
+		client->ClosePorts();                                       // Also removes the client's fifos.
+	}
+	satterm_deadline exit_deadline = Port::DeadlineAfter(SatTerm_Server::CLIENT_EXIT_WAIT);
+	for (auto& client : m_clients) {
+		client->ReapClient(exit_deadline);
+	}
+	m_clients.clear();
+	if (m_epoll_descriptor >= 0) {
+		close(m_epoll_descriptor);
+	}
+	for (int epoll_descriptor : m_port_epoll_descriptors) {
+		if (epoll_descriptor >= 0) {
+			close(epoll_descriptor);
+		}
+	}
+	for (auto const& fifo_directory : m_fifo_directories) {
+		rmdir(fifo_directory.c_str());                              // Each server has already unlinked the fifos it created there.
+	}
+}
+
+size_t SatTerm_Pool::GetClientCount(void) {
+	return m_clients.size();
+}
+
+size_t SatTerm_Pool::GetConnectedCount(void) {
+	size_t connected_count = 0;
+	for (auto const& client : m_clients) {
+		if (client->IsConnected()) {
+			connected_count ++;
+		}
+	}
+	return connected_count;
+}
+
+SatTerm_Server* SatTerm_Pool::GetClient(size_t client) {
+	// Returns the server connected to the client with index client, through which to send it messages, or NULL if the index is out of range.
+	if (client >= m_clients.size()) {
+		return NULL;
+	}
+	return m_clients[client].get();
+}
+
+size_t SatTerm_Pool::GetReadyPorts(std::vector<pool_port>& ready_ports, unsigned long timeout_seconds) {
+	return GetReadyPorts(ready_ports, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Pool::GetReadyPorts(std::vector<pool_port>& ready_ports, satterm_duration timeout) {
+	return GetReadyPorts(ready_ports, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Pool::GetReadyPorts(std::vector<pool_port>& ready_ports, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
+	
+	// As SatTerm_Agent::GetReadyPorts(), but over every Port of every client, with a single epoll instance. On return ready_ports holds each
+	// Port with a complete message waiting (or whose client has disconnected), which can then be received from GetClient(client).
+	return WaitForReadyPorts(ready_ports, GetReadinessDescriptor(), 0, m_port_identifiers.size(), deadline);
+}
+
+size_t SatTerm_Pool::GetReadyPorts(std::vector<pool_port>& ready_ports, port_handle port, unsigned long timeout_seconds) {
+	return GetReadyPorts(ready_ports, port, Port::SecondsToDuration(timeout_seconds));
+}
+
+size_t SatTerm_Pool::GetReadyPorts(std::vector<pool_port>& ready_ports, port_handle port, satterm_duration timeout) {
+	return GetReadyPorts(ready_ports, port, Port::DeadlineAfter(timeout));
+}
+
+size_t SatTerm_Pool::GetReadyPorts(std::vector<pool_port>& ready_ports, port_handle port, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
+	
+	// As above, but watching only the given Port of each client, so that messages waiting on the others (to be received elsewhere) do not
+	// cut the wait short. Every client has the same Ports, so the handle means the same Port in each.
+	if (port.index >= m_port_identifiers.size()) {
+		ready_ports.clear();
+		m_error = {error_type::oor_port_id, -1, "GetReadyPorts()"};
+		return 0;
+	}
+	if (m_port_epoll_descriptors.size() < m_port_identifiers.size()) {
+		m_port_epoll_descriptors.resize(m_port_identifiers.size(), -1);
+	}
+	int& epoll_descriptor = m_port_epoll_descriptors[port.index];
+	if (epoll_descriptor < 0) {
+		epoll_descriptor = CreateReadinessDescriptor(port.index, port.index + 1);
+	}
+	return WaitForReadyPorts(ready_ports, epoll_descriptor, port.index, port.index + 1, deadline);
+}
+
+size_t SatTerm_Pool::WaitForReadyPorts(std::vector<pool_port>& ready_ports, int epoll_descriptor, size_t first_port, size_t end_port,
+                                       satterm_deadline deadline) {
+	ready_ports.clear();
+	if (epoll_descriptor < 0) {
+		return 0;
+	}
+	
+	// Bytes left over in a receive buffer (or already in a shared memory ring) raise no epoll event, so check for these first.
+	for (size_t i = 0; i < m_clients.size(); i ++) {
+		std::vector<std::unique_ptr<Port>>& ports = m_clients[i]->m_ports;
+		for (size_t j = first_port; (j < end_port) && (j < ports.size()); j ++) {
+			bool shared_memory = (ports[j]->GetTransportMode() == transport_mode::shared_memory);
+			if (ports[j]->HasBufferedMessage() || (shared_memory && ports[j]->IsOpened() && ports[j]->IsMessageReady())) {
+				ready_ports.push_back({i, {j}});
+			}
+		}
+	}
+	
+	const int max_events = 64;
+	struct epoll_event events[max_events];
+	bool finished = false;
+	while (!finished) {
+		int timeout_ms = 0;
+		if (ready_ports.size() == 0) {
+			satterm_duration remaining = deadline - satterm_clock::now();
+			if (remaining > satterm_duration::zero()) {
+				long long remaining_ms = std::chrono::ceil<std::chrono::milliseconds>(remaining).count();
+				timeout_ms = (remaining_ms < 60000) ? (int)(remaining_ms) : 60000;
+			}
+		}
+		
+		int event_count = epoll_wait(epoll_descriptor, events, max_events, timeout_ms);
+		
+		if (event_count < 0) {
+			if (errno != EINTR) {
+				m_error = {error_type::epoll_wait, errno};
+				finished = true;
+			}
+		}
+		for (int i = 0; i < event_count; i ++) {
+			pool_port ready_port = {(size_t)(events[i].data.u64 >> 32), {(size_t)(events[i].data.u64 & 0xFFFFFFFF)}};
+			Port* port = m_clients[ready_port.client]->m_ports[ready_port.port.index].get();
+			if (!port->IsOpened()) {
+				// The Port has already reported its disconnection. Stop watching it, else a hung-up fifo will wake us forever.
+				epoll_ctl(epoll_descriptor, EPOLL_CTL_DEL, port->GetRxDescriptor(), NULL);
+				continue;
+			}
+			if (port->IsMessageReady()) {
+				if (std::find(ready_ports.begin(), ready_ports.end(), ready_port) == ready_ports.end()) {
+					ready_ports.push_back(ready_port);
+				}
+			}
+		}
+		if ((ready_ports.size() > 0) || (satterm_clock::now() >= deadline)) {
+			finished = true;
+		}
+	}
+	return ready_ports.size();
+}
+
+int SatTerm_Pool::GetReadinessDescriptor(void) {
+	// Lazily creates the epoll instance watching every client's every Port.
+	if (m_epoll_descriptor < 0) {
+		m_epoll_descriptor = CreateReadinessDescriptor(0, m_port_identifiers.size());
+	}
+	return m_epoll_descriptor;
+}
+
+int SatTerm_Pool::CreateReadinessDescriptor(size_t first_port, size_t end_port) {
+	// Creates an epoll instance watching the rx descriptor of Ports first_port to end_port - 1 of every client. Each event carries the client
+	// index in its upper 32 bits and the Port index in its lower 32 bits.
+	int epoll_descriptor = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_descriptor < 0) {
+		m_error = {error_type::epoll_create1, errno};
+		return -1;
+	}
+	for (size_t i = 0; i < m_clients.size(); i ++) {
+		std::vector<std::unique_ptr<Port>>& ports = m_clients[i]->m_ports;
+		for (size_t j = first_port; (j < end_port) && (j < ports.size()); j ++) {
+			if (ports[j]->IsOpened()) {
+				struct epoll_event event = {};
+				event.events = EPOLLIN;
+				event.data.u64 = ((uint64_t)(i) << 32) | (uint64_t)(j);
+				if (epoll_ctl(epoll_descriptor, EPOLL_CTL_ADD, ports[j]->GetRxDescriptor(), &event) < 0) {
+					m_error = {error_type::epoll_ctl, errno};
+					close(epoll_descriptor);
+					return -1;
+				}
+			}
+		}
+	}
+	return epoll_descriptor;
+}
+
+void SatTerm_Pool::OnMessage(satterm_pool_message_handler handler) {
+	// Registers the handler to which Run() dispatches each message received from any client. Pass nullptr to remove it.
+	m_message_handler = handler;
+}
+
+void SatTerm_Pool::OnDisconnect(satterm_pool_disconnect_handler handler) {
+	m_disconnect_handler = handler;
+}
+
+size_t SatTerm_Pool::Run(void) {
+	return RunUntil(satterm_deadline::max());
+}
+
+size_t SatTerm_Pool::RunFor(satterm_duration duration) {
+	return RunUntil(Port::DeadlineAfter(duration));
+}
+
+size_t SatTerm_Pool::RunUntil(satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
+	
+	// As SatTerm_Agent::RunUntil(), but for every client from the one thread. A client disconnecting is reported to the disconnect handler,
+	// and Run() carries on with the rest, returning once Stop() is called, every client has disconnected or the deadline passes.
+	size_t dispatched_count = 0;
+	std::vector<pool_port> ready_ports = {};
+	std::vector<std::string> messages = {};
+	
+	m_reactor_stop = false;
+	while (!m_reactor_stop && (GetConnectedCount() > 0) && (satterm_clock::now() < deadline)) {
+		GetReadyPorts(ready_ports, deadline);
+		if (m_error.Get().type != error_type::none) {
+			break;
+		}
+		for (size_t i = 0; (i < ready_ports.size()) && !m_reactor_stop; i ++) {
+			SatTerm_Server& client = *m_clients[ready_ports[i].client];
+			bool port_drained = false;
+			while (!port_drained && !m_reactor_stop) {
+				port_drained = (client.GetMessages(ready_ports[i].port, messages, 1, false, satterm_deadline()) == 0);
+				error_state error = client.GetErrorState();
+				if (!port_drained && m_message_handler) {
+					m_message_handler(ready_ports[i].client, ready_ports[i].port, messages[0]);
+					dispatched_count ++;
+				}
+				if (error.type != error_type::none) {
+					if (!client.IsConnected() && m_disconnect_handler) {
+						m_disconnect_handler(ready_ports[i].client, client.GetPortIdentifier(ready_ports[i].port), Port::DescribeError(error));
+					}
+					port_drained = true;
+				}
+			}
+		}
+	}
+	return dispatched_count;
+}
+
+void SatTerm_Pool::Stop(void) {
+	// Makes Run() return once the handler that called Stop() returns.
+	m_reactor_stop = true;
+}
+
+error_descriptor SatTerm_Pool::GetErrorCode(void) {
+	return Port::DescribeError(m_error);
+}
+
+error_state SatTerm_Pool::GetErrorState(void) {
+	return m_error;
+}
@@ -12,26 +12,56 @@
 
 #include <iostream>                   // std::cout, std::cerr, std::endl;
 #include <string>                     // std::string, std::to_string.
+#include <string_view>                // std::string_view.
 #include <map>                        // std::map.
 #include <vector>                     // std::vector.
-#include <ctime>                      // time().
+#include <chrono>                     // std::chrono::steady_clock, std::chrono::duration_cast.
+#include <cstring>                    // memchr().
 
-#include <stdio.h>                    // perror().
+#include <stdio.h>                    // perror(), fopen(), fscanf().
 #include <sys/stat.h>                 // open() and O_RDONLY, O_WRONLY, etc.
-#include <fcntl.h>                    // open() and O_RDONLY, O_WRONLY, etc.
+#include <fcntl.h>                    // open(), fcntl(), splice(), vmsplice() and O_RDONLY, O_WRONLY, F_SETPIPE_SZ, etc.
 #include <unistd.h>                   // write(), read(), close(), unlink().
 #include <errno.h>                    // errno.
 #include <signal.h>                   // SIGPIPE, SIG_IGN.
+#include <poll.h>                     // poll(), ppoll(), POLLIN, POLLOUT.
+#include <sys/uio.h>                  // writev(), struct iovec.
+#include <limits.h>                   // IOV_MAX, PIPE_BUF.
+#include <sched.h>                    // sched_getaffinity(), CPU_COUNT.
+#include <sys/socket.h>               // socket(), bind(), listen(), accept4(), connect(), shutdown(), getsockopt(), SO_PEERCRED.
+#include <sys/un.h>                   // struct sockaddr_un.
+#include <cstddef>                    // offsetof().
+#include <sys/ioctl.h>                // ioctl(), FIONREAD.
+#include <linux/sockios.h>            // SIOCOUTQ.
 
 
 #include "satterm_port.h"
 
-Port::Port(bool is_server, std::string const& working_path, std::string const& identifier, bool display_messages, char end_char) {
+// Size of the per-port receive buffer. Matches the default Linux pipe capacity so that a single read() can drain a full fifo.
+static const size_t RX_BUFFER_SIZE = 65536;
+
+// Longest timeout representable by a satterm_deadline without overflow. Longer timeouts are treated as effectively infinite.
+static const unsigned long MAX_TIMEOUT_SECONDS = 100UL * 365 * 24 * 60 * 60;
+
+// Largest record written to a seqpacket Port's socket. A record must be read whole, and every read is into at least RX_BUFFER_SIZE bytes.
+static const size_t SEQPACKET_RECORD_MAX = RX_BUFFER_SIZE;
+
+// Sends that must find the tx fifo full before a Port with options.adaptive_pipe_size doubles its capacity.
+static const uint32_t PIPE_GROW_BLOCKS = 8;
+
+Port::Port(bool is_server, std::string const& working_path, std::string const& identifier, bool display_messages, char end_char,
+           port_options const& options) {
+	// Constructing a Port only starts opening it (see StartOpen()), SatTerm_Agent::OpenSession() completes it.
 	m_working_path = working_path;
 	m_identifier = identifier;
 	
 	m_display_messages = display_messages;
 	m_end_char = end_char;
+	cpu_set_t cpu_set;                                             // Polling a ring only helps if the sender can run meanwhile.
+	if ((sched_getaffinity(0, sizeof(cpu_set), &cpu_set) == 0) && (CPU_COUNT(&cpu_set) > 1)) {
+		m_ring_spin = options.ring_spin;
+	}
+	m_rx_buffer.resize(RX_BUFFER_SIZE);
 	
 	if (is_server) {
 		m_fifos.in.identifier = identifier + "_sin";
@@ -43,43 +73,58 @@ Port::Port(bool is_server, std::string const& working_path, std::string const& i
 	
 	signal(SIGPIPE, SIG_IGN);
 	
-	m_fifos.in.created = CreateFifo(m_working_path + m_fifos.in.identifier);
-	
-	OpenFifos(is_server, 5);
+	StartOpen(is_server, options);
 }
 
 Port::~Port() {
+	if (m_open_step == open_step::pending) {
+		FailOpen();
+	}
 	CloseFifos();
-	UnlinkInFifo();
+	UnlinkFifos();
 }
 
 void Port::CloseFifos(void) {
+	// A seqpacket Port's socket stands in for both fifos. Shutting down its sending side is the counterpart of closing the tx fifo, and
+	// the socket itself is closed last.
 	if (m_fifos.out.opened) {
 		m_fifos.out.opened = false;
-		close(m_fifos.out.descriptor);
+		if (m_socket_descriptor >= 0) {
+			shutdown(m_socket_descriptor, SHUT_WR);
+		} else {
+			close(m_fifos.out.descriptor);
+		}
 	}
 	if (m_fifos.in.opened) {
 		while (m_fifos.in.opened) {
-			usleep(10);
-			GetMessage(false, 0);
+			GetMessage(false, DeadlineAfter(std::chrono::seconds(1)));
 		}
-		close(m_fifos.in.descriptor);
+		if (m_socket_descriptor < 0) {
+			close(m_fifos.in.descriptor);
+		}
+	}
+	if (m_socket_descriptor >= 0) {
+		close(m_socket_descriptor);
+		m_socket_descriptor = -1;
 	}
 }
 
-void Port::UnlinkInFifo(void) {
-	if (m_fifos.in.created) {
-		std::string fifo_path = m_working_path + m_fifos.in.identifier;
-		int status = unlink(fifo_path.c_str());
-		if ((status < 0) && m_display_messages) {
-			std::string error_message = "Unable to unlink() fifo at " + fifo_path;
-			perror(error_message.c_str());
+void Port::UnlinkFifos(void) {
+	// The server creates both fifos, so it unlinks both.
+	for (fifo const* fifo : {&m_fifos.in, &m_fifos.out}) {
+		if (fifo->created) {
+			std::string fifo_path = m_working_path + fifo->identifier;
+			int status = unlink(fifo_path.c_str());
+			if ((status < 0) && m_display_messages) {
+				std::string error_message = "Unable to unlink() fifo at " + fifo_path;
+				perror(error_message.c_str());
+			}
 		}
 	}
 }
 
 bool Port::CreateFifo(std::string const& fifo_path) {
-	m_error_code = {0, ""};
+	m_error = {error_type::none, 0};
 	bool success = false;
 	
 	remove(fifo_path.c_str());	// If temporary file already exists, delete it.
@@ -88,7 +133,7 @@ bool Port::CreateFifo(std::string const& fifo_path) {
 
 	if (status < 0) {
 		// Info on possible errors for mkfifo() - https://pubs.opengroup.org/onlinepubs/009696799/functions/mkfifo.html
-		m_error_code = {errno, "mkfifo()"};
+		m_error = {error_type::mkfifo, errno};
 		if (m_display_messages) {
 			std::string error_message = "mkfifo() error trying to create fifo " + fifo_path;
 			perror(error_message.c_str());
@@ -100,178 +145,788 @@ bool Port::CreateFifo(std::string const& fifo_path) {
 	return success;
 }
 
-bool Port::OpenFifos(bool is_server, unsigned long timeout_seconds) {
-	if (is_server) {
-		m_fifos.in.opened = OpenRxFifo(m_working_path + m_fifos.in.identifier, timeout_seconds);
-		if (m_fifos.in.opened) {
-			m_fifos.out.opened = OpenTxFifo(m_working_path + m_fifos.out.identifier, timeout_seconds);
+void Port::StartOpen(bool is_server, port_options const& options) {
+	// Does all of the opening that needs nothing from the counterpart. The server creates both fifos and opens its rx fifo (or listens on
+	// the socket) before it starts the client, so the client finds everything in place and opens its ends (or connects) at once, before
+	// it sends its session hello (see SatTerm_Agent::OpenSession()). The hello therefore tells the server that the client's ends are
+	// open, and CompleteServerOpen() opens the server's tx fifo (or accepts the connection) without waiting either. Nothing is exchanged
+	// through the Port itself, and nothing is retried. The session Port's own messages, which are sent before it opens, use the framing
+	// in options.
+	m_is_server = is_server;
+	m_options = options;
+	m_framing = options.framing;
+	m_open_step = open_step::pending;
+	bool success = true;
+	if (options.transport == transport_mode::seqpacket) {
+		m_transport = transport_mode::seqpacket;
+		success = is_server ? ListenSocket() : ConnectSocket();
+	} else if (is_server) {
+		m_fifos.in.created = CreateFifo(m_working_path + m_fifos.in.identifier);
+		m_fifos.out.created = m_fifos.in.created && CreateFifo(m_working_path + m_fifos.out.identifier);
+		success = m_fifos.out.created && OpenRxFifo();
+	} else {
+		success = OpenRxFifo() && OpenTxFifo();
+	}
+	if (!success) {
+		FailOpen();
+	}
+}
+
+bool Port::CompleteServerOpen(bool shared_memory) {
+	// Called once the client's session hello has arrived. shared_memory is false if the client cannot map a shared memory segment, in
+	// which case a Port asked for shared memory transport stays on its fifos.
+	if (m_open_step != open_step::pending) {
+		return false;
+	}
+	bool success = (m_transport == transport_mode::seqpacket) ? AcceptSocket() : OpenTxFifo();
+	if (!success) {
+		return FailOpen();
+	}
+	if (shared_memory && (m_options.transport == transport_mode::shared_memory)) {
+		CreateSharedMemory(m_options.ring_size);
+	}
+	FinishOpen(m_options.framing);
+	return true;
+}
+
+bool Port::CompleteClientOpen(framing_mode framing, std::string const& shm_name) {
+	// Called with the terms of the server's session welcome. The client adopts the server's framing mode, and its shared memory segment if
+	// it named one.
+	if (m_open_step != open_step::pending) {
+		return false;
+	}
+	if ((shm_name.size() > 0) && ((m_transport == transport_mode::seqpacket) || !OpenSharedMemory(shm_name))) {
+		if (m_error.Get().type == error_type::none) {
+			m_error = {error_type::invalid_init, -1};
+		}
+		return FailOpen();
+	}
+	FinishOpen(framing);
+	return true;
+}
+
+void Port::FinishOpen(framing_mode framing) {
+	m_framing = framing;
+	m_fifos.in.opened = true;
+	m_fifos.out.opened = true;
+	m_open_step = open_step::opened;
+	if (m_transport == transport_mode::seqpacket) {
+		if (m_display_messages) {
+			std::string message = "Port " + m_identifier + " opened seqpacket socket on descriptor " + std::to_string(m_socket_descriptor);
+			std::cerr << message << std::endl;
 		}
+	} else if (m_shm.IsMapped()) {
+		StartSharedMemory(m_is_server);
+	} else {
+		SizePipes(m_options);
+	}
+}
+
+bool Port::FailOpen(void) {
+	// Closes whatever had been opened so far. Any error has already been recorded by the step that failed. Always returns false.
+	if (m_listen_descriptor >= 0) {
+		close(m_listen_descriptor);
+		m_listen_descriptor = -1;
+	}
+	if (m_socket_descriptor >= 0) {
+		close(m_socket_descriptor);
+		m_socket_descriptor = -1;
 	} else {
-		m_fifos.out.opened = OpenTxFifo(m_working_path + m_fifos.out.identifier, timeout_seconds);
-		if (m_fifos.out.opened) {
-			m_fifos.in.opened = OpenRxFifo(m_working_path + m_fifos.in.identifier, timeout_seconds);
+		if (m_fifos.in.descriptor >= 0) {
+			close(m_fifos.in.descriptor);
+		}
+		if (m_fifos.out.descriptor >= 0) {
+			close(m_fifos.out.descriptor);
 		}
 	}
-	return (m_fifos.in.opened && m_fifos.out.opened);
+	m_fifos.in.descriptor = -1;
+	m_fifos.out.descriptor = -1;
+	m_open_step = open_step::failed;
+	return false;
 }
 
-bool Port::OpenRxFifo(std::string const& fifo_path, unsigned long timeout_seconds) {
-	m_error_code = {0, ""};
+bool Port::ReceiveHandshake(std::string& message, satterm_deadline deadline) {
+	// Waits until deadline for the counterpart's session message, which arrives before the Port has opened. Until then EOF on the rx fifo
+	// only means that the counterpart has yet to open it for writing. poll() reports a hang-up only once a writer has come and gone, so
+	// that means the counterpart gave up (or died) part way through.
+	m_error = {error_type::none, 0};
+	while (!IsMessageReady()) {
+		satterm_duration wait_time = deadline - satterm_clock::now();
+		if (wait_time <= satterm_duration::zero()) {
+			m_error = {error_type::session_timeout, -1};
+			return false;
+		}
+		std::chrono::seconds wait_seconds = std::chrono::duration_cast<std::chrono::seconds>(wait_time);
+		std::chrono::nanoseconds wait_nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(wait_time - wait_seconds);
+		struct timespec wait_timespec = {(time_t)(wait_seconds.count()), (long)(wait_nanoseconds.count())};
+		
+		struct pollfd poll_descriptor = {m_fifos.in.descriptor, POLLIN, 0};
+		int status = ppoll(&poll_descriptor, 1, &wait_timespec, NULL);
+		if ((status > 0) && (poll_descriptor.revents & (POLLHUP | POLLERR)) && !IsMessageReady()) {
+			m_error = {error_type::read_eof, -1};
+			return false;
+		}
+	}
+	message = GetMessage(false, satterm_deadline());
+	return (m_error.Get().type == error_type::none);
+}
+
+std::string Port::GetSharedMemoryName(void) {
+	// The name of the segment the server created for this Port, for its session welcome, or empty if the Port is not using one.
+	return m_shm.IsMapped() ? m_shm.GetName() : "";
+}
+
+bool Port::CreateSharedMemory(size_t ring_size) {
+	// Failing this is not fatal. The server simply does not announce shared memory, and both ends carry on using the fifos.
+	int err_no = 0;
+	bool success = m_shm.Create(ring_size, err_no);
+	if (!success && m_display_messages) {
+		errno = err_no;
+		std::string error_message = "Port " + m_identifier + " unable to create shared memory, using fifo transport";
+		perror(error_message.c_str());
+	}
+	return success;
+}
+
+bool Port::OpenSharedMemory(std::string const& shm_name) {
+	int err_no = 0;
+	bool success = m_shm.Open(shm_name, err_no);
+	if (!success) {
+		m_error = {error_type::shm_open, err_no};
+		if (m_display_messages) {
+			errno = err_no;
+			std::string error_message = "Port " + m_identifier + " unable to open shared memory " + shm_name;
+			perror(error_message.c_str());
+		}
+	}
+	return success;
+}
+
+void Port::StartSharedMemory(bool is_server) {
+	// From here on the fifos only carry wake-ups, so anything already read from the rx fifo is dropped.
+	m_tx_ring = m_shm.GetRing(is_server ? SatTerm_SharedMemory::SERVER_TO_CLIENT : SatTerm_SharedMemory::CLIENT_TO_SERVER);
+	m_rx_ring = m_shm.GetRing(is_server ? SatTerm_SharedMemory::CLIENT_TO_SERVER : SatTerm_SharedMemory::SERVER_TO_CLIENT);
+	m_rx_start = 0;
+	m_rx_end = 0;
+	m_transport = transport_mode::shared_memory;
 	
-	int fifo_descriptor = open(fifo_path.c_str(), O_RDONLY | O_NONBLOCK);
+	// The tx fifo now only carries wake-ups, so shrink it to the minimum (a page) to keep filling it when the ring is full (see WriteTx())
+	// cheap. If this fails, filling it just takes a few more write() calls.
+	int status = fcntl(m_fifos.out.descriptor, F_SETPIPE_SZ, PIPE_BUF);
+	(void)(status);
+}
+
+bool Port::ListenSocket(void) {
+	// The server listens and the client connects, so there is nothing to create in (or unlink from) the working directory. Once connected
+	// the socket stands in for both fifos, so the fifo I/O paths work on it unchanged, and each read() of it returns one record.
+	m_error = {error_type::none, 0};
 	
-	bool success = false;
-	if (!(fifo_descriptor < 0)) {
-		m_fifos.in.descriptor = fifo_descriptor;
-		m_current_message = "";
-		
-		std::string init_message = GetMessage(false, timeout_seconds);
-		
-		if (init_message == "init") {
-			if (m_display_messages) {
-				std::string message = "Port " + m_identifier + " opened fifo " + fifo_path + " for reading on descriptor " + std::to_string(fifo_descriptor);
-				std::cerr << message << std::endl;
-			}
-			success = true;
-		} else {
-			m_fifos.in.descriptor = 0;
-			if (m_error_code == error_descriptor{-1, "GetMessage()_tx_unconn_timeout"}) {
-				if (m_display_messages) {
-					std::string error_message =  "Port " + m_identifier + " opened fifo " + fifo_path + " for reading on descriptor " + std::to_string(fifo_descriptor) + " but timed-out waiting for an init message.";
-					std::cerr << error_message << std::endl;
-				}
+	struct sockaddr_un address = {};
+	socklen_t address_length = GetSocketAddress(address);
+	int socket_descriptor = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if ((socket_descriptor < 0) || (bind(socket_descriptor, (struct sockaddr const*)(&address), address_length) < 0) ||
+	    (listen(socket_descriptor, 1) < 0)) {
+		m_error = {error_type::socket, errno};
+		if (m_display_messages) {
+			std::string error_message = "Port " + m_identifier + " unable to listen on seqpacket socket";
+			perror(error_message.c_str());
+		}
+		if (socket_descriptor >= 0) {
+			close(socket_descriptor);
+		}
+		return false;
+	}
+	m_listen_descriptor = socket_descriptor;
+	return true;
+}
+
+bool Port::AcceptSocket(void) {
+	// The client connected before it sent its session hello, so the connection is already waiting.
+	int socket_descriptor = accept4(m_listen_descriptor, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+	if (socket_descriptor < 0) {
+		m_error = {error_type::socket, errno};
+		if (m_display_messages) {
+			std::string error_message = "Port " + m_identifier + " unable to accept() on seqpacket socket";
+			perror(error_message.c_str());
+		}
+		return false;
+	}
+	
+	// Abstract sockets have no file permissions, so check instead that the client belongs to the same user.
+	struct ucred credentials = {};
+	socklen_t credentials_length = sizeof(credentials);
+	if ((getsockopt(socket_descriptor, SOL_SOCKET, SO_PEERCRED, &credentials, &credentials_length) < 0) || (credentials.uid != geteuid())) {
+		m_error = {error_type::socket, EACCES};
+		close(socket_descriptor);
+		return false;
+	}
+	close(m_listen_descriptor);                                         // Only ever one connection per Port.
+	m_listen_descriptor = -1;
+	m_socket_descriptor = socket_descriptor;
+	m_fifos.in.descriptor = socket_descriptor;
+	m_fifos.out.descriptor = socket_descriptor;
+	return true;
+}
+
+bool Port::ConnectSocket(void) {
+	// The server listens before it starts the client, so connect() succeeds first time (its backlog holds the one connection).
+	m_error = {error_type::none, 0};
+	
+	struct sockaddr_un address = {};
+	socklen_t address_length = GetSocketAddress(address);
+	int socket_descriptor = socket(AF_UNIX, SOCK_SEQPACKET | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if (socket_descriptor < 0) {
+		m_error = {error_type::socket, errno};
+		if (m_display_messages) {
+			std::string error_message = "Port " + m_identifier + " unable to create seqpacket socket";
+			perror(error_message.c_str());
+		}
+		return false;
+	}
+	m_socket_descriptor = socket_descriptor;
+	m_fifos.in.descriptor = socket_descriptor;
+	m_fifos.out.descriptor = socket_descriptor;
+	if (connect(socket_descriptor, (struct sockaddr const*)(&address), address_length) < 0) {
+		m_error = {error_type::connect, errno};
+		if (m_display_messages) {
+			std::string error_message = "Port " + m_identifier + " unable to connect() seqpacket socket";
+			perror(error_message.c_str());
+		}
+		return false;
+	}
+	return true;
+}
+
+socklen_t Port::GetSocketAddress(struct sockaddr_un& address) {
+	// A name starting with a null byte is in the abstract namespace, which needs no file and vanishes with the socket. Like the fifo paths,
+	// it is derived from the working path and Port identifier, hashed (64-bit FNV-1a) to fit in sun_path.
+	uint64_t hash = 14695981039346656037ULL;
+	std::string key = m_working_path + m_identifier;
+	for (char c : key) {
+		hash = (hash ^ (unsigned char)(c)) * 1099511628211ULL;
+	}
+	char name[64];
+	int name_length = snprintf(name, sizeof(name), "satellite_terminal_%016llx", (unsigned long long)(hash));
+	address.sun_family = AF_UNIX;
+	address.sun_path[0] = '\0';
+	memcpy(address.sun_path + 1, name, (size_t)(name_length));
+	return (socklen_t)(offsetof(struct sockaddr_un, sun_path) + 1 + (size_t)(name_length));
+}
+
+void Port::SizePipes(port_options const& options) {
+	// A pipe's capacity belongs to the pipe rather than to either end, so the server sizing both fifos sizes them for the client too.
+	// Failing to get the capacity asked for is not fatal, GetPipeSize() reports what was actually granted.
+	if (options.pipe_size > 0) {
+		SetPipeSize(m_fifos.out.descriptor, options.pipe_size);
+		SetPipeSize(m_fifos.in.descriptor, options.pipe_size);
+	}
+	m_adaptive_pipe_size = options.adaptive_pipe_size;
+}
+
+size_t Port::SetPipeSize(int descriptor, size_t pipe_size) {
+	// Returns the capacity granted, which the kernel rounds up to a power-of-two number of pages, or 0 if the fifo was not resized.
+	size_t max_size = GetPipeMaxSize();
+	if ((max_size > 0) && (pipe_size > max_size)) {
+		pipe_size = max_size;
+	}
+	int status = fcntl(descriptor, F_SETPIPE_SZ, (int)(pipe_size));
+	if ((status < 0) && m_display_messages) {
+		std::string error_message = "Port " + m_identifier + " unable to set fifo capacity to " + std::to_string(pipe_size) + " bytes";
+		perror(error_message.c_str());
+	}
+	return (status < 0) ? 0 : (size_t)(status);
+}
+
+bool Port::GrowTxPipe(void) {
+	// Called by senders each time they find the tx fifo full. Every PIPE_GROW_BLOCKS-th time the fifo's capacity is doubled, up to the
+	// system limit, so a Port that keeps hitting backpressure ends up with enough buffering to absorb its bursts. Returns true if it grew,
+	// in which case the sender can retry at once rather than wait for the reader.
+	if (!m_adaptive_pipe_size.load(std::memory_order_relaxed) || (m_transport != transport_mode::fifo) ||
+	    (((m_tx_block_count.fetch_add(1, std::memory_order_relaxed) + 1) % PIPE_GROW_BLOCKS) != 0)) {
+		return false;
+	}
+	int pipe_size = fcntl(m_fifos.out.descriptor, F_GETPIPE_SZ);
+	size_t max_size = GetPipeMaxSize();
+	if ((pipe_size < 0) || ((size_t)(pipe_size) >= max_size) || (SetPipeSize(m_fifos.out.descriptor, (size_t)(pipe_size) * 2) <= (size_t)(pipe_size))) {
+		m_adaptive_pipe_size = false;                               // At the limit (or refused, eg: per-user pipe quota), so stop trying.
+		return false;
+	}
+	if (m_display_messages) {
+		std::string message = "Port " + m_identifier + " grew fifo " + m_fifos.out.identifier + " to " + std::to_string(GetPipeSize(true)) + " bytes";
+		std::cerr << message << std::endl;
+	}
+	return true;
+}
+
+size_t Port::GetPipeMaxSize(void) {
+	// The largest capacity an unprivileged process may give a pipe. Read once, it only changes if an administrator writes to it.
+	static const size_t pipe_max_size = []() {
+		size_t max_size = 1048576;                                  // The kernel default, should the file be unreadable.
+		FILE* file = fopen("/proc/sys/fs/pipe-max-size", "r");
+		if (file != NULL) {
+			unsigned long value = 0;
+			if (fscanf(file, "%lu", &value) == 1) {
+				max_size = (size_t)(value);
 			}
-			success = false;
+			fclose(file);
 		}
-	} else {
-		m_error_code = {errno, "open()_rx"};
+		return max_size;
+	}();
+	return pipe_max_size;
+}
+
+bool Port::OpenRxFifo(void) {
+	// Opening for reading without O_NONBLOCK would block until the counterpart opens the fifo for writing. The server opens its read ends
+	// before it starts the client, so O_CLOEXEC keeps the client from inheriting them (holding the read end of its own tx fifo, a client
+	// would never see EPIPE once the server had gone).
+	std::string fifo_path = m_working_path + m_fifos.in.identifier;
+	int fifo_descriptor = open(fifo_path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fifo_descriptor < 0) {
+		m_error = {error_type::open_rx, errno};
 		if (m_display_messages) {
 			std::string error_message = "Port " + m_identifier + " unable to open fifo at " + fifo_path + " for reading.";
 			perror(error_message.c_str());
 		}
-		success = false;
+		return false;
 	}
-	return success;
+	if (m_display_messages) {
+		std::string message = "Port " + m_identifier + " opened fifo " + fifo_path + " for reading on descriptor " + std::to_string(fifo_descriptor);
+		std::cerr << message << std::endl;
+	}
+	m_fifos.in.descriptor = fifo_descriptor;
+	m_current_message.clear();
+	m_rx_message_delivered = false;
+	m_rx_start = 0;
+	m_rx_end = 0;
+	return true;
+}
+
+bool Port::OpenTxFifo(void) {
+	// open() fails with ENXIO if the counterpart has not opened the fifo for reading. See StartOpen() for why it always has by now.
+	std::string fifo_path = m_working_path + m_fifos.out.identifier;
+	int fifo_descriptor = open(fifo_path.c_str(), O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+	if (fifo_descriptor < 0) {
+		m_error = {error_type::open_tx, errno};
+		if (m_display_messages) {
+			std::string error_message = "Port " + m_identifier + " unable to open() fifo at " + fifo_path + " for writing.";
+			perror(error_message.c_str());
+		}
+		return false;
+	}
+	if (m_display_messages) {
+		std::string message = "Port " + m_identifier + " opened fifo " + fifo_path + " for writing on descriptor " + std::to_string(fifo_descriptor);
+		std::cerr << message << std::endl;
+	}
+	m_fifos.out.descriptor = fifo_descriptor;
+	return true;
 }
 
-bool Port::OpenTxFifo(std::string const& fifo_path, unsigned long timeout_seconds) {
-	m_error_code = {0, ""};
+bool Port::WaitForDescriptor(int descriptor, short events, satterm_deadline deadline, satterm_duration max_wait) {
+	satterm_duration wait_time = deadline - satterm_clock::now();
+	if (wait_time <= satterm_duration::zero()) {
+		return false;
+	}
+	if ((max_wait > satterm_duration::zero()) && (max_wait < wait_time)) {
+		wait_time = max_wait;
+	}
+	std::chrono::seconds wait_seconds = std::chrono::duration_cast<std::chrono::seconds>(wait_time);
+	std::chrono::nanoseconds wait_nanoseconds = std::chrono::duration_cast<std::chrono::nanoseconds>(wait_time - wait_seconds);
+	struct timespec wait_timespec = {(time_t)(wait_seconds.count()), (long)(wait_nanoseconds.count())};
 	
-	int fifo_descriptor = PollToOpenTxFifo(fifo_path, timeout_seconds); 
+	struct pollfd poll_descriptor = {descriptor, events, 0};
+	int status = ppoll(&poll_descriptor, 1, &wait_timespec, NULL);
+	return (status > 0);
+}
 
-	bool success = false;
-	if (fifo_descriptor >= 0) {
-		if (m_display_messages) {
-			std::string message = "Port " + m_identifier + " opened fifo " + fifo_path + " for writing on descriptor " + std::to_string(fifo_descriptor);
-			std::cerr << message << std::endl;
+satterm_duration Port::SecondsToDuration(unsigned long timeout_seconds) {
+	if (timeout_seconds > MAX_TIMEOUT_SECONDS) {
+		timeout_seconds = MAX_TIMEOUT_SECONDS;
+	}
+	return std::chrono::seconds(timeout_seconds);
+}
+
+satterm_deadline Port::DeadlineAfter(satterm_duration timeout) {
+	return satterm_clock::now() + timeout;
+}
+
+std::string Port::SendMessage(std::string const& message, unsigned long timeout_seconds) {
+	return SendMessage(message, DeadlineAfter(SecondsToDuration(timeout_seconds)));
+}
+
+std::string Port::SendMessage(std::string const& message, satterm_deadline deadline) {
+	std::string_view message_part = message;
+	size_t message_bytes_sent = SendFrame(&message_part, 1, deadline);
+	
+	if (message_bytes_sent < message.size()) {                      // Sent part of message.
+		return message.substr(message_bytes_sent, std::string::npos);
+	} else {                                                        // Sent whole message (an unsent m_end_char is sent with the next message).
+		return "";
+	}
+}
+
+size_t Port::SendMessage(std::vector<std::string_view> const& message_parts, unsigned long timeout_seconds) {
+	return SendMessage(message_parts, DeadlineAfter(SecondsToDuration(timeout_seconds)));
+}
+
+size_t Port::SendMessage(std::vector<std::string_view> const& message_parts, satterm_deadline deadline) {
+	return SendFrame(message_parts.data(), message_parts.size(), deadline);
+}
+
+size_t Port::SendFrame(std::string_view const* message_parts, size_t part_count, satterm_deadline deadline) {
+	// Sends the concatenation of message_parts as a single framed message. Returns the number of message bytes (excluding framing bytes)
+	// that were sent. Safe to call from several threads at once (as are SendMessages() and SendBytes()).
+	size_t message_length = 0;
+	for (size_t i = 0; i < part_count; i ++) {
+		message_length += message_parts[i].size();
+	}
+	
+	size_t message_bytes_sent = 0;
+	if (!SendAtomicFrame(message_parts, part_count, message_length, deadline, message_bytes_sent)) {
+		m_tx_sequencer.Lock();
+		message_bytes_sent = SendFrameLocked(message_parts, part_count, message_length, deadline);
+		m_tx_sequencer.Unlock(IsTxFrameOpen());
+	}
+	return message_bytes_sent;
+}
+
+bool Port::SendAtomicFrame(std::string_view const* message_parts, size_t part_count, size_t message_length, satterm_deadline deadline,
+                           size_t& message_bytes_sent) {
+	// Lock-free path for small frames. POSIX guarantees that a write() of at most PIPE_BUF bytes to a fifo is never interleaved with
+	// other writers, and a non-blocking one writes either everything or nothing. Returns false, having sent nothing, if the frame must go
+	// the locked way instead (too big, fifo broken, a frame left part-sent by an earlier send must be finished first, or the Port uses
+	// shared memory, whose ring takes one writer at a time).
+	const size_t max_parts = 8;
+	size_t framing_length = (m_framing == framing_mode::length_prefix) ? sizeof(uint32_t) : 1;
+	if ((part_count > max_parts) || (message_length > (PIPE_BUF - framing_length)) || !m_fifos.out.opened ||
+	    (m_transport == transport_mode::shared_memory)) {
+		return false;
+	}
+	
+	struct iovec iovecs[max_parts + 1];
+	size_t iovec_count = 0;
+	uint32_t frame_length = (uint32_t)(message_length);
+	if (m_framing == framing_mode::length_prefix) {
+		iovecs[iovec_count ++] = {(void*)(&frame_length), sizeof(frame_length)};
+	}
+	for (size_t i = 0; i < part_count; i ++) {
+		if (message_parts[i].size() > 0) {
+			iovecs[iovec_count ++] = {(void*)(message_parts[i].data()), message_parts[i].size()};
 		}
-		
-		m_fifos.out.descriptor = fifo_descriptor;
-		
-		std::string init_message = "init";
-		init_message = SendMessage(init_message, timeout_seconds);
-		
-		if (GetErrorCode().err_no != 0) {
-			m_fifos.out.descriptor = 0;
-			success = false;
+	}
+	if (m_framing == framing_mode::end_char) {
+		iovecs[iovec_count ++] = {(void*)(&m_end_char), 1};
+	}
+	
+	message_bytes_sent = 0;
+	satterm_deadline start_time = satterm_deadline::min();          // Only read the clock if we have to wait.
+	while (true) {
+		bool waited = false;
+		if (m_tx_sequencer.TryEnterShared()) {
+			ssize_t status = writev(m_fifos.out.descriptor, iovecs, (int)(iovec_count));
+			m_tx_sequencer.LeaveShared();
+			if (status == (ssize_t)(message_length + framing_length)) {
+				m_error = {error_type::none, 0};
+				message_bytes_sent = message_length;
+				return true;
+			} else if ((status >= 0) || (errno != EAGAIN)) {
+				return false;                   // Let the locked path retry the write and report the error.
+			}
+			if (start_time == satterm_deadline::min()) {
+				start_time = satterm_clock::now();
+			}
+			waited = GrowTxPipe() || WaitForDescriptor(m_fifos.out.descriptor, POLLOUT, deadline);    // Sleep until the reader drains the fifo.
 		} else {
-			success = true;
+			if (start_time == satterm_deadline::min()) {
+				start_time = satterm_clock::now();
+			}
+			waited = m_tx_sequencer.WaitForShared(deadline);              // Sleep until the Lock() holder has finished its frame.
+			if (!waited && !m_tx_sequencer.IsLocked()) {
+				return false;                   // A frame was left part-sent and only the locked path may finish it.
+			}
+		}
+		if (!waited && (satterm_clock::now() >= deadline)) {
+			if (deadline <= start_time) {
+				m_error = {error_type::write_thread_block, EAGAIN};
+			} else {
+				m_error = {error_type::write_thread_block_timeout, EAGAIN};
+			}
+			return true;
 		}
-	} else {
-		success = false;
 	}
-	return success;
 }
 
-int Port::PollToOpenTxFifo(std::string const& fifo_path, unsigned long timeout_seconds) {
-	m_error_code = {0, ""};
+size_t Port::SendFrameLocked(std::string_view const* message_parts, size_t part_count, size_t message_length, satterm_deadline deadline,
+                             bool map_pages) {
+	m_error = {error_type::none, 0};
 	
-	unsigned long start_time = time(0);
-	int fifo_descriptor = -1;
+	// Writes the frame with one writev() per attempt, so the payload is never copied to add the framing bytes. The caller must hold
+	// m_tx_sequencer. If map_pages is set, the payload is instead mapped into the fifo with vmsplice() (see SendBulk()).
+	m_tx_iovecs.clear();
 	
-	bool finished = false;
-	while (!finished) {
-		
-		fifo_descriptor = open(fifo_path.c_str(), O_WRONLY | O_NONBLOCK);
-		
-		if (fifo_descriptor >= 0) {
-			finished = true;
-		} else {
-			switch (errno) {
-				case ENXIO:
-					finished = ((time(0) - start_time) > timeout_seconds);
-					if (finished) {
-						m_error_code = {-1, "PollToOpenTxFifo()_rx_conn_timeout"};
-					}
-					break;
-				case ENOENT:
-					finished = ((time(0) - start_time) > timeout_seconds);
-					if (finished) {
-						m_error_code = {-1, "PollToOpenTxFifo()_no_tx_fifo_timeout"};
-					}
-					break;
-				default:
-					m_error_code = {errno, "open()_tx"};
-					if (m_display_messages) {
-						std::string error_message = "Port " + m_identifier + " unable to open() fifo at" + fifo_path + " for writing.";
-						perror(error_message.c_str());
-					}
-					finished = true;
+	// Framing bytes owed by an earlier interrupted send (an unsent end char, or the tail of a length header) go out first.
+	if (m_tx_pending_prefix.size() > 0) {
+		m_tx_iovecs.push_back({(void*)(m_tx_pending_prefix.data()), m_tx_pending_prefix.size()});
+	}
+	uint32_t frame_length = 0;
+	bool has_header = false;
+	if (m_framing == framing_mode::length_prefix) {
+		if (m_tx_frame_remaining == 0) {
+			if (message_length > UINT32_MAX) {
+				m_error = {error_type::message_too_long, -1};
+				return 0;
 			}
+			frame_length = (uint32_t)(message_length);
+			has_header = true;
+			m_tx_iovecs.push_back({(void*)(&frame_length), sizeof(frame_length)});
+		} else if (message_length != m_tx_frame_remaining) {
+			// The length header already sent promised exactly the unsent remainder, and anything else would corrupt the stream.
+			m_error = {error_type::frame_remainder_mismatch, -1};
+			return 0;
 		}
+		// Otherwise the message is the unsent remainder of a frame whose length header has already been sent.
+	}
+	size_t first_part_iovec = m_tx_iovecs.size();
+	for (size_t i = 0; i < part_count; i ++) {
+		if (message_parts[i].size() > 0) {
+			m_tx_iovecs.push_back({(void*)(message_parts[i].data()), message_parts[i].size()});
+		}
+	}
+	size_t end_part_iovec = m_tx_iovecs.size();
+	if (m_framing == framing_mode::end_char) {
+		m_tx_iovecs.push_back({(void*)(&m_end_char), 1});
 	}
-	return fifo_descriptor;
+	
+	size_t bytes_sent = 0;
+	if (map_pages && (m_transport == transport_mode::fifo)) {
+		// Only the payload is mapped. The framing bytes are held in memory that is reused as soon as this returns (frame_length is on the
+		// stack), so they are copied as usual, before and after it.
+		size_t boundaries[4] = {0, first_part_iovec, end_part_iovec, m_tx_iovecs.size()};
+		for (size_t i = 0; i < 3; i ++) {
+			size_t range_length = 0;
+			for (size_t j = boundaries[i]; j < boundaries[i + 1]; j ++) {
+				range_length += m_tx_iovecs[j].iov_len;
+			}
+			size_t range_bytes_sent = SendIovecs(m_tx_iovecs.data() + boundaries[i], boundaries[i + 1] - boundaries[i], deadline, (i == 1));
+			bytes_sent += range_bytes_sent;
+			if (range_bytes_sent < range_length) {
+				break;
+			}
+		}
+	} else {
+		bytes_sent = SendIovecs(m_tx_iovecs.data(), m_tx_iovecs.size(), deadline);
+	}
+	
+	size_t message_bytes_sent = 0;
+	if (bytes_sent < m_tx_pending_prefix.size()) {                 // Did not even finish sending the framing bytes owed from before.
+		m_tx_pending_prefix.erase(0, bytes_sent);
+	} else {
+		bytes_sent -= m_tx_pending_prefix.size();
+		m_tx_pending_prefix.clear();
+		CommitFrame(bytes_sent, message_length, has_header, message_bytes_sent);
+	}
+	return message_bytes_sent;
 }
 
-std::string Port::SendMessage(std::string const& message, unsigned long timeout_seconds) {
-	m_error_code = {0, ""};
+size_t Port::SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, unsigned long timeout_seconds) {
+	return SendMessages(messages, remaining_message, DeadlineAfter(SecondsToDuration(timeout_seconds)));
+}
+
+size_t Port::SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, satterm_deadline deadline) {
+	m_tx_sequencer.Lock();
+	m_error = {error_type::none, 0};
+	
+	// Frames every message into one iovec array so that the whole batch is written with as few writev() calls as possible. Returns the
+	// number of messages delivered. If that is less than messages.size(), remaining_message holds the unsent remainder of the first
+	// undelivered message (to be passed to SendMessage() next) and none of the messages after it have been sent.
+	remaining_message.clear();
 	
-	std::string working_message = message;
-	working_message.push_back(m_end_char);
-	size_t working_message_length = working_message.size();
+	if ((m_framing == framing_mode::length_prefix) && (m_tx_frame_remaining > 0) && (messages.size() > 0) &&
+	    (messages[0].size() != m_tx_frame_remaining)) {
+		m_error = {error_type::frame_remainder_mismatch, -1};      // As in SendFrameLocked().
+		remaining_message = messages[0];
+		m_tx_sequencer.Unlock(IsTxFrameOpen());
+		return 0;
+	}
 	
-	size_t bytes_sent = SendBytes(working_message.c_str(), working_message_length, timeout_seconds);
+	size_t message_count = messages.size();
+	for (size_t i = 0; i < messages.size(); i ++) {
+		if ((m_framing == framing_mode::length_prefix) && (messages[i].size() > UINT32_MAX)) {
+			message_count = i;
+			break;
+		}
+	}
 	
-	if (bytes_sent == working_message_length) {                     // Sent whole working_message including m_end_char.
-		return "";
-	} else if (bytes_sent == (working_message_length - 1)) {        // Sent whole message but did not send m_end_char.
-		return "";
-	} else {                                                        // Sent part of message.
-		return message.substr(bytes_sent, std::string::npos);
+	m_tx_iovecs.clear();
+	m_tx_frame_lengths.resize(message_count);
+	if (m_tx_pending_prefix.size() > 0) {
+		m_tx_iovecs.push_back({(void*)(m_tx_pending_prefix.data()), m_tx_pending_prefix.size()});
+	}
+	bool first_frame_continues = ((m_framing == framing_mode::length_prefix) && (m_tx_frame_remaining > 0));
+	for (size_t i = 0; i < message_count; i ++) {
+		if ((m_framing == framing_mode::length_prefix) && !((i == 0) && first_frame_continues)) {
+			m_tx_frame_lengths[i] = (uint32_t)(messages[i].size());
+			m_tx_iovecs.push_back({(void*)(&m_tx_frame_lengths[i]), sizeof(uint32_t)});
+		}
+		if (messages[i].size() > 0) {
+			m_tx_iovecs.push_back({(void*)(messages[i].data()), messages[i].size()});
+		}
+		if (m_framing == framing_mode::end_char) {
+			m_tx_iovecs.push_back({(void*)(&m_end_char), 1});
+		}
+	}
+	
+	size_t bytes_sent = SendIovecs(m_tx_iovecs.data(), m_tx_iovecs.size(), deadline);
+	
+	size_t messages_sent = 0;
+	if (bytes_sent < m_tx_pending_prefix.size()) {                 // Did not even finish sending the framing bytes owed from before.
+		m_tx_pending_prefix.erase(0, bytes_sent);
+		bytes_sent = 0;
+	} else {
+		bytes_sent -= m_tx_pending_prefix.size();
+		m_tx_pending_prefix.clear();
 	}
+	for (size_t i = 0; i < message_count; i ++) {
+		bool has_header = ((m_framing == framing_mode::length_prefix) && !((i == 0) && first_frame_continues));
+		size_t frame_size = (has_header ? sizeof(uint32_t) : 0) + messages[i].size() + ((m_framing == framing_mode::end_char) ? 1 : 0);
+		size_t frame_bytes_sent = (bytes_sent < frame_size) ? bytes_sent : frame_size;
+		bytes_sent -= frame_bytes_sent;
+		
+		size_t message_bytes_sent = 0;
+		if (CommitFrame(frame_bytes_sent, messages[i].size(), has_header, message_bytes_sent)) {
+			messages_sent ++;
+		} else {
+			remaining_message = messages[i].substr(message_bytes_sent, std::string::npos);
+			break;
+		}
+	}
+	if ((messages_sent == message_count) && (message_count < messages.size())) {
+		m_error = {error_type::message_too_long, -1};
+		remaining_message = messages[message_count];
+	}
+	m_tx_sequencer.Unlock(IsTxFrameOpen());
+	return messages_sent;
+}
+
+bool Port::CommitFrame(size_t frame_bytes_sent, size_t message_length, bool has_header, size_t& message_bytes_sent) {
+	// Updates the framing state once the first frame_bytes_sent bytes of a frame carrying message_length message bytes have been written.
+	// Returns true if the whole message was sent (even if its end char was not, in which case that is sent ahead of the next message).
+	message_bytes_sent = 0;
+	if (frame_bytes_sent == 0) {                                    // Sent nothing, so nothing about the framing state has changed.
+		return false;
+	}
+	size_t header_length = has_header ? sizeof(uint32_t) : 0;
+	m_tx_frame_open = false;
+	if (frame_bytes_sent < header_length) {                         // Sent part of the length header only.
+		uint32_t frame_length = (uint32_t)(message_length);
+		m_tx_pending_prefix.assign((const char*)(&frame_length) + frame_bytes_sent, header_length - frame_bytes_sent);
+		m_tx_frame_remaining = message_length;
+		return false;
+	}
+	message_bytes_sent = frame_bytes_sent - header_length;
+	if (message_bytes_sent < message_length) {                      // Sent part of message.
+		m_tx_frame_remaining = (m_framing == framing_mode::length_prefix) ? (message_length - message_bytes_sent) : 0;
+		m_tx_frame_open = (m_framing == framing_mode::end_char);
+		return false;
+	}
+	message_bytes_sent = message_length;
+	m_tx_frame_remaining = 0;
+	if ((m_framing == framing_mode::end_char) && (frame_bytes_sent < (message_length + 1))) {   // Sent whole message but not m_end_char.
+		m_tx_pending_prefix = std::string(1, m_end_char);
+	}
+	return true;
+}
+
+bool Port::IsTxFrameOpen(void) {
+	// True while the receiver is part-way through a frame, so that the next bytes written must continue it rather than start another.
+	return ((m_tx_pending_prefix.size() > 0) || (m_tx_frame_remaining > 0) || m_tx_frame_open);
 }
 
 size_t Port::SendBytes(const char* bytes, size_t byte_count, unsigned long timeout_seconds) {
-	m_error_code = {0, ""};
+	return SendBytes(bytes, byte_count, DeadlineAfter(SecondsToDuration(timeout_seconds)));
+}
+
+size_t Port::SendBytes(const char* bytes, size_t byte_count, satterm_deadline deadline) {
+	struct iovec bytes_iovec = {(void*)(bytes), byte_count};
+	m_tx_sequencer.Lock();
+	size_t bytes_sent = SendIovecs(&bytes_iovec, 1, deadline);
+	m_tx_sequencer.Unlock(IsTxFrameOpen());
+	return bytes_sent;
+}
+
+bool Port::FlushTx(satterm_deadline deadline) {
+	// Sends only the framing bytes (an end char) still owed by an earlier send, for a sender that has no next message to send them with.
+	// Returns true once nothing is owed.
+	m_tx_sequencer.Lock();
+	m_error = {error_type::none, 0};
+	if (m_tx_pending_prefix.size() > 0) {
+		struct iovec prefix_iovec = {(void*)(m_tx_pending_prefix.data()), m_tx_pending_prefix.size()};
+		m_tx_pending_prefix.erase(0, SendIovecs(&prefix_iovec, 1, deadline));
+	}
+	bool flushed = (m_tx_pending_prefix.size() == 0);
+	m_tx_sequencer.Unlock(IsTxFrameOpen());
+	return flushed;
+}
+
+size_t Port::SendBulk(const char* bytes, size_t byte_count, unsigned long timeout_seconds) {
+	return SendBulk(bytes, byte_count, DeadlineAfter(SecondsToDuration(timeout_seconds)));
+}
+
+size_t Port::SendBulk(const char* bytes, size_t byte_count, satterm_deadline deadline) {
+	// Sends bytes as a single framed message, as SendMessage() does, but maps the pages holding them into the fifo with vmsplice() rather
+	// than copying them. The fifo then refers to those pages until the counterpart has read them, so the caller must not modify bytes
+	// until it has been received. Returns the number of bytes sent. If that is less than byte_count, the remainder is owed (as with
+	// SendMessage()). Over shared memory the bytes are copied into the ring as usual.
+	std::string_view message_part(bytes, byte_count);
+	m_tx_sequencer.Lock();
+	size_t message_bytes_sent = SendFrameLocked(&message_part, 1, byte_count, deadline, true);
+	m_tx_sequencer.Unlock(IsTxFrameOpen());
+	return message_bytes_sent;
+}
+
+size_t Port::SendIovecs(struct iovec* iovecs, size_t iovec_count, satterm_deadline deadline, bool map_pages) {
+	m_error = {error_type::none, 0};
 	
-	unsigned long start_time = time(0);
-	bool finished = false;
-	size_t bytes_remaining = byte_count;
-	size_t offset = 0;
+	// Writes out every iovec in order, resuming after partial writes. The iovecs are modified in-place to track progress.
+	satterm_deadline start_time = satterm_clock::now();
+	size_t bytes_sent = 0;
+	size_t iovec_index = 0;
+	while ((iovec_index < iovec_count) && (iovecs[iovec_index].iov_len == 0)) {
+		iovec_index ++;
+	}
+	bool finished = (iovec_index == iovec_count);
 
 	while (!finished) {
 		
-		int status = write(m_fifos.out.descriptor, bytes + offset, bytes_remaining);
+		int write_count = (iovec_count - iovec_index < (size_t)(IOV_MAX)) ? (int)(iovec_count - iovec_index) : IOV_MAX;
+		ssize_t status = WriteTx(iovecs + iovec_index, write_count, map_pages);
 		
 		if (status >= 0) {
-			if ((size_t)(status) == bytes_remaining) {
-				finished = true;
+			bytes_sent += (size_t)(status);
+			size_t bytes_written = (size_t)(status);
+			while ((iovec_index < iovec_count) && (bytes_written >= iovecs[iovec_index].iov_len)) {
+				bytes_written -= iovecs[iovec_index].iov_len;
+				iovec_index ++;
+			}
+			if (iovec_index < iovec_count) {
+				iovecs[iovec_index].iov_base = (char*)(iovecs[iovec_index].iov_base) + bytes_written;
+				iovecs[iovec_index].iov_len -= bytes_written;
 			} else {
-				offset += (size_t)(status);
+				finished = true;
 			}
-			bytes_remaining -= (size_t)(status);
 		} else {
 			switch (errno) {
 				case EAGAIN:                    // Erro - thread would block (reader currently reading, etc). Try again unless timeout.
-					finished = ((time(0) - start_time) > timeout_seconds);
-					if ((finished) && (timeout_seconds == 0)) {
-						m_error_code = {errno, "write()_thread_block"};
-					} else if ((finished) && (timeout_seconds > 0)) {
-						m_error_code = {errno, "write()_thread_block_timeout"};
+					finished = (satterm_clock::now() >= deadline);
+					if ((finished) && (deadline <= start_time)) {
+						m_error = {error_type::write_thread_block, errno};
+					} else if (finished) {
+						m_error = {error_type::write_thread_block_timeout, errno};
+					} else if (!GrowTxPipe()) {
+						WaitForDescriptor(m_fifos.out.descriptor, POLLOUT, deadline);   // Sleep until the reader drains the fifo.
 					}
 					break;
 				default:                        // Trap all other write() errors here.
-					m_error_code = {errno, "write()"};
+					m_error = {error_type::write, errno};
 					if (m_display_messages) {
 						std::string error_message = "Port " + m_identifier + " unable to write() to fifo at" + m_fifos.out.identifier;
 						perror(error_message.c_str());
@@ -281,83 +936,666 @@ size_t Port::SendBytes(const char* bytes, size_t byte_count, unsigned long timeo
 			}
 		}
 	}
-	return byte_count - bytes_remaining;
+	return bytes_sent;
+}
+
+ssize_t Port::WriteTx(struct iovec const* iovecs, int iovec_count, bool map_pages) {
+	// Behaves as writev() to the tx fifo, whichever the transport. With shared memory the bytes go into the ring, and the fifo is only
+	// written to wake a receiver that found the ring empty.
+	if ((m_transport == transport_mode::fifo) && map_pages) {
+		return vmsplice(m_fifos.out.descriptor, iovecs, (unsigned long)(iovec_count), SPLICE_F_NONBLOCK);
+	} else if (m_transport == transport_mode::fifo) {
+		return writev(m_fifos.out.descriptor, iovecs, iovec_count);
+	} else if (m_transport == transport_mode::seqpacket) {
+		// Each write is one record, so write only the iovecs that fit in SEQPACKET_RECORD_MAX bytes (or the start of the first). The
+		// receiver reads records back as one byte stream, so a frame may span several.
+		size_t record_length = 0;
+		int record_iovec_count = 0;
+		while ((record_iovec_count < iovec_count) && (record_length + iovecs[record_iovec_count].iov_len <= SEQPACKET_RECORD_MAX)) {
+			record_length += iovecs[record_iovec_count].iov_len;
+			record_iovec_count ++;
+		}
+		if (record_iovec_count == 0) {
+			struct iovec record_iovec = {iovecs[0].iov_base, SEQPACKET_RECORD_MAX};
+			return writev(m_fifos.out.descriptor, &record_iovec, 1);
+		}
+		return writev(m_fifos.out.descriptor, iovecs, record_iovec_count);
+	}
+	size_t bytes_written = m_tx_ring.Write(iovecs, (size_t)(iovec_count));
+	if (bytes_written == 0) {
+		// The ring is full. Fill the tx fifo as well, which the receiver drains once it has made space in the ring, so that waiting for
+		// POLLOUT on the fifo (as every sender does) waits for that space.
+		m_tx_ring.SetWriterWaiting();
+		bytes_written = m_tx_ring.Write(iovecs, (size_t)(iovec_count));
+		if (bytes_written == 0) {
+			static const char filler[PIPE_BUF] = {};
+			while (write(m_fifos.out.descriptor, filler, sizeof(filler)) > 0) {}
+			if (errno != EAGAIN) {
+				return -1;                                              // The receiver has gone away (EPIPE).
+			}
+			bytes_written = m_tx_ring.Write(iovecs, (size_t)(iovec_count));
+			if (bytes_written == 0) {
+				errno = EAGAIN;
+				return -1;
+			}
+		}
+	}
+	if (m_tx_ring.TakeReaderWaiting()) {
+		const char wake_up = 0;
+		ssize_t status = write(m_fifos.out.descriptor, &wake_up, 1);   // A full fifo already wakes the receiver, and a broken one
+		(void)(status);                                                 // is reported by the next write that needs it.
+	}
+	return (ssize_t)(bytes_written);
+}
+
+ssize_t Port::ReadRx(char* buffer, size_t size) {
+	// Behaves as read() from the rx fifo, whichever the transport: returns the number of bytes read, 0 once the counterpart has closed its
+	// end (and, with shared memory, everything it put in the ring has been read), or -1 with errno EAGAIN if there is nothing to read yet.
+	// A seqpacket read() returns one record, discarding whatever of it does not fit, but size is never less than SEQPACKET_RECORD_MAX.
+	if (m_transport != transport_mode::shared_memory) {
+		return read(m_fifos.in.descriptor, buffer, size);
+	}
+	size_t bytes_read = m_rx_ring.Read(buffer, size);
+	if (bytes_read == 0) {
+		// Discarding the wake-ups on the fifo also reveals whether the counterpart has closed it. It closes the fifo only after writing
+		// its last bytes to the ring, so look again before reporting EOF.
+		ssize_t status = DrainRxFifo();
+		bytes_read = m_rx_ring.Read(buffer, size);
+		if (bytes_read == 0) {
+			return status;
+		}
+	}
+	if (m_rx_ring.TakeWriterWaiting()) {
+		DrainRxFifo();                                                  // The sender is waiting for POLLOUT on its full tx fifo.
+	}
+	return (ssize_t)(bytes_read);
+}
+
+bool Port::SpinForRx(satterm_deadline deadline) {
+	// A receiver that polls the ring for a moment picks up a prompt reply without either side entering the kernel, where sleeping
+	// would cost a wake-up through the fifo on each message. Returns true if bytes arrived before m_ring_spin (or deadline) passed.
+	if ((m_transport != transport_mode::shared_memory) || (m_ring_spin == satterm_duration::zero())) {
+		return false;
+	}
+	satterm_deadline spin_deadline = satterm_clock::now() + m_ring_spin;
+	if (deadline < spin_deadline) {
+		spin_deadline = deadline;
+	}
+	while (true) {
+		for (int i = 0; i < 64; i ++) {
+			if (!m_rx_ring.IsEmpty()) {
+				return true;
+			}
+#if defined(__x86_64__) || defined(__i386__)
+			__builtin_ia32_pause();
+#endif
+		}
+		if (satterm_clock::now() >= spin_deadline) {
+			return false;
+		}
+	}
+}
+
+bool Port::PrepareRxWait(void) {
+	// Must be called before sleeping on the rx descriptor of a shared memory Port, as the sender only writes a wake-up to the fifo for a
+	// receiver that has asked for one. Busy receivers therefore cost the sender no system calls. Returns true if bytes arrived in the
+	// meantime, in which case read them rather than sleeping.
+	if (m_transport != transport_mode::shared_memory) {
+		return false;
+	}
+	m_rx_ring.SetReaderWaiting();
+	return !m_rx_ring.IsEmpty();
+}
+
+ssize_t Port::DrainRxFifo(void) {
+	// Once a shared memory Port is open, bytes on its rx fifo are only ever wake-ups, so they are discarded. Returns the status of the last
+	// read(), which is 0 (EOF) once the counterpart has closed the fifo.
+	char discarded[PIPE_BUF];
+	ssize_t status = 0;
+	do {
+		status = read(m_fifos.in.descriptor, discarded, sizeof(discarded));
+	} while (status > 0);
+	return status;
 }
 
 std::string Port::GetMessage(bool capture_end_char, unsigned long timeout_seconds) {
-	m_error_code = {0, ""};
+	return GetMessage(capture_end_char, DeadlineAfter(SecondsToDuration(timeout_seconds)));
+}
+
+std::string Port::GetMessage(bool capture_end_char, satterm_deadline deadline) {
+	return std::string(GetMessageView(capture_end_char, deadline));
+}
+
+std::string_view Port::GetMessageView(bool capture_end_char, unsigned long timeout_seconds) {
+	return GetMessageView(capture_end_char, DeadlineAfter(SecondsToDuration(timeout_seconds)));
+}
+
+std::string_view Port::GetMessageView(bool capture_end_char, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
 	
-	unsigned long start_time = 0;
-	if (timeout_seconds > 0) {
-		start_time = time(0);
+	std::string_view message = {};
+	ReceiveMessage(capture_end_char, deadline, message);
+	return message;
+}
+
+size_t Port::GetMessages(std::vector<std::string>& messages, size_t max_count, bool capture_end_char, unsigned long timeout_seconds) {
+	return GetMessages(messages, max_count, capture_end_char, DeadlineAfter(SecondsToDuration(timeout_seconds)));
+}
+
+size_t Port::GetMessages(std::vector<std::string>& messages, size_t max_count, bool capture_end_char, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
+	
+	// Waits until deadline for the first message only, then collects every further complete message that can be had without blocking.
+	// Existing elements of messages are overwritten in-place so that their capacity is reused from one call to the next. The vector is
+	// never shrunk: only the first message_count elements are valid, any beyond that are spare buffers left over from earlier calls.
+	size_t message_count = 0;
+	std::string_view message = {};
+	satterm_deadline receive_deadline = deadline;
+	
+	while ((message_count < max_count) && ReceiveMessage(capture_end_char, receive_deadline, message)) {
+		if (message_count < messages.size()) {
+			messages[message_count].assign(message);
+		} else {
+			messages.emplace_back(message);
+		}
+		message_count ++;
+		receive_deadline = satterm_deadline();
 	}
+	return message_count;
+}
+
+size_t Port::ReceiveBulk(int descriptor, unsigned long timeout_seconds) {
+	return ReceiveBulk(descriptor, DeadlineAfter(SecondsToDuration(timeout_seconds)));
+}
+
+size_t Port::ReceiveBulk(int descriptor, satterm_deadline deadline) {
+	m_error = {error_type::none, 0};
+	
+	// Receives the next message into descriptor (eg a file, socket or pipe, in blocking mode) rather than into memory, and returns the number
+	// of its bytes written there. With length prefix framing over the fifos, the message body is moved from the rx fifo to descriptor
+	// with splice(), so none of it passes through user space other than what was already read into the receive buffer. Otherwise the
+	// message is received as usual and then written out.
+	if ((m_framing == framing_mode::end_char) || (m_transport != transport_mode::fifo)) {
+		std::string_view message = {};
+		size_t bytes_written = 0;
+		if (ReceiveMessage(false, deadline, message)) {
+			int err_no = 0;
+			bytes_written = WriteToDescriptor(descriptor, message.data(), message.size(), deadline, err_no);
+			if (bytes_written < message.size()) {
+				m_error = {error_type::bulk_output, err_no};
+			}
+		}
+		return bytes_written;
+	}
+	ReleaseDeliveredMessage();
 	
+	size_t bytes_written = 0;
+	if ((m_rx_header_count == sizeof(uint32_t)) && (m_current_message.size() > 0)) {
+		// An earlier receive stopped part-way through this message, leaving the part it received ahead of room for the rest. That part
+		// goes first.
+		int err_no = 0;
+		size_t received_count = m_current_message.size() - m_rx_frame_remaining;
+		bytes_written = WriteToDescriptor(descriptor, m_current_message.data(), received_count, deadline, err_no);
+		m_current_message.erase(0, bytes_written);
+		if (bytes_written < received_count) {
+			m_error = {error_type::bulk_output, err_no};
+			return bytes_written;
+		}
+		m_current_message.clear();
+	}
+	
+	satterm_deadline start_time = satterm_clock::now();
+	bool use_splice = true;
 	bool finished = false;
-	bool end_char_received = false;
-	char char_in;
-	std::string message;
 	
 	while (!finished) {
+		int status = 1;
+		int err_no = 0;
+		size_t write_count = 0;
+		size_t count = 0;
+		if (m_rx_header_count < sizeof(uint32_t)) {
+			// Take the length header from the receive buffer, or else read only the header from the fifo, so that none of the body is read.
+			if (m_rx_start < m_rx_end) {
+				while ((m_rx_header_count < sizeof(uint32_t)) && (m_rx_start < m_rx_end)) {
+					m_rx_header[m_rx_header_count ++] = m_rx_buffer[m_rx_start ++];
+				}
+			} else {
+				status = ReadRx(m_rx_header + m_rx_header_count, sizeof(uint32_t) - m_rx_header_count);
+				if (status > 0) {
+					m_rx_header_count += (size_t)(status);
+				}
+			}
+			if (m_rx_header_count == sizeof(uint32_t)) {
+				uint32_t frame_length = 0;
+				memcpy(&frame_length, m_rx_header, sizeof(frame_length));
+				m_rx_frame_remaining = frame_length;
+				m_current_message.clear();
+			}
+		} else if (m_rx_frame_remaining == 0) {
+			m_rx_header_count = 0;
+			m_rx_bulk_frame = false;
+			m_current_message.clear();
+			finished = true;
+			continue;
+		} else if ((m_rx_start < m_rx_end) || !use_splice) {
+			// Body bytes already read into the receive buffer are written out from there, as is everything if descriptor cannot be spliced to.
+			if (m_rx_start == m_rx_end) {
+				status = ReadRx(m_rx_buffer.data(), m_rx_buffer.size());
+				if (status > 0) {
+					m_rx_start = 0;
+					m_rx_end = (size_t)(status);
+				}
+			}
+			if (status > 0) {
+				size_t buffered_count = m_rx_end - m_rx_start;
+				write_count = (m_rx_frame_remaining < buffered_count) ? m_rx_frame_remaining : buffered_count;
+				count = WriteToDescriptor(descriptor, m_rx_buffer.data() + m_rx_start, write_count, deadline, err_no);
+				m_rx_start += count;
+				m_rx_frame_remaining -= count;
+				if (m_rx_start == m_rx_end) {
+					m_rx_start = 0;
+					m_rx_end = 0;
+				}
+			}
+		} else {
+			ssize_t spliced = splice(m_fifos.in.descriptor, NULL, descriptor, NULL, m_rx_frame_remaining, SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+			if (spliced > 0) {
+				count = (size_t)(spliced);
+				write_count = count;
+				m_rx_frame_remaining -= count;
+			} else if ((spliced < 0) && (errno == EINVAL)) {         // descriptor does not support splice() (eg opened with O_APPEND).
+				use_splice = false;
+			} else if ((spliced < 0) && (errno != EAGAIN)) {         // Only descriptor can fail this way, as the rx fifo is open.
+				err_no = errno;
+				write_count = 1;
+			} else {
+				status = (int)(spliced);
+			}
+		}
 		
-		int status = read(m_fifos.in.descriptor, &char_in, 1);
+		bytes_written += count;
+		if (status <= 0) {                      // Nothing to read from the fifo yet (or ever).
+			finished = WaitForRx(status, start_time, deadline);
+		} else if (count < write_count) {
+			m_error = {error_type::bulk_output, err_no};
+			finished = true;
+		}
+	}
+	
+	if ((m_rx_header_count == sizeof(uint32_t)) && (m_rx_frame_remaining > 0)) {
+		// Stopped part-way through the body. The part already written out is not kept, so only another ReceiveBulk() can finish it.
+		m_rx_bulk_frame = true;
+	}
+	return bytes_written;
+}
+
+size_t Port::WriteToDescriptor(int descriptor, const char* bytes, size_t byte_count, satterm_deadline deadline, int& err_no) {
+	// Writes byte_count bytes to descriptor, waiting (until deadline) while it is full if it is non-blocking. Returns the number written,
+	// which is less than byte_count only if it failed, with the reason in err_no.
+	size_t bytes_written = 0;
+	err_no = 0;
+	while (bytes_written < byte_count) {
+		ssize_t status = write(descriptor, bytes + bytes_written, byte_count - bytes_written);
+		if (status > 0) {
+			bytes_written += (size_t)(status);
+		} else if ((status < 0) && (errno == EINTR)) {
+			continue;
+		} else if ((status < 0) && (errno == EAGAIN) && WaitForDescriptor(descriptor, POLLOUT, deadline)) {
+			continue;
+		} else {
+			err_no = (status < 0) ? errno : EIO;
+			break;
+		}
+	}
+	return bytes_written;
+}
+
+bool Port::ReceiveMessage(bool capture_end_char, satterm_deadline deadline, std::string_view& message) {
+	// Returns true if a complete message was received into message, which may legitimately be empty.
+	ReleaseDeliveredMessage();
+	if (m_rx_bulk_frame) {
+		m_error = {error_type::bulk_frame_in_progress, -1};
+		return false;
+	}
+	
+	satterm_deadline start_time = satterm_clock::now();
+	
+	bool finished = false;
+	bool received = false;
+	
+	while (!finished) {
 		
-		if (status > 0) {                       // read() read-in a character to the char buffer.
-			if (char_in != m_end_char) {
-				m_current_message.push_back(char_in);
-			} else {
-				if (capture_end_char) {
-					m_current_message.push_back(char_in);
+		if (TakeBufferedMessage(capture_end_char, message)) {     // A complete message already in the receive buffer is returned in-place.
+			received = true;
+			finished = true;
+			continue;
+		}
+		if (ConsumeRxBuffer(capture_end_char)) {        // Consume any bytes left over in the receive buffer from a previous read() first.
+			message = m_current_message;
+			m_rx_message_delivered = true;
+			received = true;
+			finished = true;
+			continue;
+		}
+		
+		int status = ReadRxFifo();
+		
+		if (status > 0) {                       // read() read-in a chunk of bytes, go round again to consume them.
+			continue;
+		}
+		finished = WaitForRx(status, start_time, deadline);
+	}
+	return received;
+}
+
+bool Port::WaitForRx(int status, satterm_deadline start_time, satterm_deadline deadline) {
+	// Called when a read from the rx fifo returned status (0 or -1) rather than bytes. Waits (until deadline) for more bytes if there may
+	// yet be some, or records why there will be none. Returns true if the receive is finished.
+	bool finished = false;
+	if (status == 0) {                                                   // EOF. read() will return this if no process has the pipe open for writing.
+			if (!m_fifos.in.opened) {
+				finished = (satterm_clock::now() >= deadline);           // If the Component has not finished initialising, assume that the partner
+				if (finished) {                                          // component hasn't opened the fifo for writing yet so continue to poll   
+					m_error = {error_type::tx_unconn_timeout, -1};         // until timeout.
+				} else {
+					WaitForDescriptor(m_fifos.in.descriptor, POLLIN, deadline);
 				}
-				message = m_current_message;
-				m_current_message = "";
-				end_char_received = true;
+			} else {                                                     // If the Component is initialised, the partner component no-longer has the
+				m_error = {error_type::read_eof, -1};                       // fifo open for writing (has become disconnected).
+				if (m_display_messages) {
+					std::string error_message = "EOF on GetMessage() for Port " + m_identifier + " suggests counterpart terminated.";
+					std::cerr << error_message << std::endl;
+				}
+				m_fifos.in.opened = false;
 				finished = true;
 			}
+	
+	} else if (status < 0) {                // read() indicates an error.
+		switch (errno) {                    // See under errors here - https://pubs.opengroup.org/onlinepubs/009604599/functions/read.html
+			case EAGAIN:					// Non-blocking read on empty fifo with connected writer will return -1 with error EAGAIN,
+				finished = (satterm_clock::now() >= deadline);                                   // so we continue to poll unless timeout.
+				if (finished && (deadline > start_time)) {      // Only set m_error to EAGAIN if we have been waiting on a timeout.
+					m_error = {error_type::tx_conn_timeout, errno};
+				} else if (!finished && !SpinForRx(deadline) && !PrepareRxWait()) {     // Sleep until the writer sends more bytes
+					WaitForDescriptor(m_fifos.in.descriptor, POLLIN, deadline);             // (or disconnects).
+				}
+				break;
+			default:                        // Trap all other read() errors here.
+				m_error = {error_type::read, errno};
+				if (m_display_messages) {
+					std::string error_message = "Port " + m_identifier + " unable to read() from fifo at " + m_fifos.in.identifier;
+					perror(error_message.c_str());
+				}
+				m_fifos.in.opened = false;
+				finished = true;
+		}
+	}
+	return finished;
+}
+
+bool Port::TakeBufferedMessage(bool capture_end_char, std::string_view& message) {
+	// If no partial message is being assembled and the receive buffer holds a complete message, point message at it without copying.
+	if ((m_current_message.size() > 0) || (m_rx_header_count > 0) || (m_rx_start == m_rx_end)) {
+		return false;
+	}
+	const char* unread = m_rx_buffer.data() + m_rx_start;
+	size_t unread_count = m_rx_end - m_rx_start;
+	
+	if (m_framing == framing_mode::end_char) {
+		const char* end_char_position = (const char*)(memchr(unread, m_end_char, unread_count));
+		if (end_char_position == NULL) {
+			return false;
+		}
+		size_t message_length = (size_t)(end_char_position - unread);
+		message = std::string_view(unread, capture_end_char ? (message_length + 1) : message_length);
+		m_rx_start += message_length + 1;
+	} else {
+		uint32_t frame_length = 0;
+		if (unread_count < sizeof(frame_length)) {
+			return false;
+		}
+		memcpy(&frame_length, unread, sizeof(frame_length));
+		if ((unread_count - sizeof(frame_length)) < frame_length) {
+			return false;
+		}
+		message = std::string_view(unread + sizeof(frame_length), frame_length);
+		m_rx_start += sizeof(frame_length) + frame_length;
+	}
+	return true;
+}
+
+void Port::ReleaseDeliveredMessage(void) {
+	// A message assembled in m_current_message stays valid (for GetMessageView()) until the next receive. Clearing rather than
+	// re-assigning it keeps its capacity for the next message.
+	if (m_rx_message_delivered) {
+		m_current_message.clear();
+		m_rx_message_delivered = false;
+	}
+}
+
+bool Port::ConsumeRxBuffer(bool capture_end_char) {
+	// Moves bytes from the receive buffer into m_current_message. Returns true once m_current_message holds a complete message.
+	bool message_complete = false;
+	
+	if (m_framing == framing_mode::end_char) {
+		if (m_rx_start < m_rx_end) {
+			const char* unread = m_rx_buffer.data() + m_rx_start;
+			size_t unread_count = m_rx_end - m_rx_start;
+			const char* end_char_position = (const char*)(memchr(unread, m_end_char, unread_count));
 			
-		} else if (status == 0) {                                            // EOF. read() will return this if no process has the pipe open for writing.
-				if (!m_fifos.in.opened) {
-					finished = ((time(0) - start_time) > timeout_seconds);   // If the Component has not finished initialising, assume that the partner
-					if (finished) {                                          // component hasn't opened the fifo for writing yet so continue to poll   
-						m_error_code = {-1, "GetMessage()_tx_unconn_timeout"};         // until timeout.
-					}
-				} else {                                                     // If the Component is initialised, the partner component no-longer has the
-					m_error_code = {-1, "read()_EOF"};                       // fifo open for writing (has become disconnected).
-					if (m_display_messages) {
-						std::string error_message = "EOF on GetMessage() for Port " + m_identifier + " suggests counterpart terminated.";
-						std::cerr << error_message << std::endl;
-					}
-					m_fifos.in.opened = false;
-					finished = true;
+			if (end_char_position != NULL) {
+				size_t message_length = (size_t)(end_char_position - unread);
+				m_current_message.append(unread, message_length);
+				if (capture_end_char) {
+					m_current_message.push_back(m_end_char);
 				}
-		
-		} else if (status < 0) {                // read() indicates an error.
-			switch (errno) {                    // See under errors here - https://pubs.opengroup.org/onlinepubs/009604599/functions/read.html
-				case EAGAIN:					// Non-blocking read on empty fifo with connected writer will return -1 with error EAGAIN,
-					finished = ((time(0) - start_time) > timeout_seconds);                           // so we continue to poll unless timeout.
-					if (finished && (timeout_seconds > 0)) {        // Only set m_error_code to EAGAIN if we have been waiting on a timeout.
-						m_error_code = {errno, "GetMessage()_tx_conn_timeout"};
-					}
-					break;
-				default:                        // Trap all other read() errors here.
-					m_error_code = {errno, "read()"};
-					if (m_display_messages) {
-						std::string error_message = "Port " + m_identifier + " unable to read() from fifo at " + m_fifos.in.identifier;
-						perror(error_message.c_str());
-					}
-					m_fifos.in.opened = false;
-					finished = true;
+				m_rx_start += message_length + 1;
+				message_complete = true;
+			} else {
+				m_current_message.append(unread, unread_count);
+				m_rx_start = m_rx_end;
+			}
+		}
+	} else {
+		if (m_rx_header_count < sizeof(uint32_t)) {
+			while ((m_rx_header_count < sizeof(uint32_t)) && (m_rx_start < m_rx_end)) {
+				m_rx_header[m_rx_header_count] = m_rx_buffer[m_rx_start];
+				m_rx_header_count ++;
+				m_rx_start ++;
+			}
+			if (m_rx_header_count == sizeof(uint32_t)) {
+				uint32_t frame_length = 0;
+				memcpy(&frame_length, m_rx_header, sizeof(frame_length));
+				m_current_message.resize(frame_length);        // The whole body is allocated once, then filled in place.
+				m_rx_frame_remaining = frame_length;
 			}
 		}
+		if (m_rx_header_count == sizeof(uint32_t)) {
+			size_t unread_count = m_rx_end - m_rx_start;
+			size_t copy_count = (m_rx_frame_remaining < unread_count) ? m_rx_frame_remaining : unread_count;
+			memcpy(&m_current_message[m_current_message.size() - m_rx_frame_remaining], m_rx_buffer.data() + m_rx_start, copy_count);
+			m_rx_start += copy_count;
+			m_rx_frame_remaining -= copy_count;
+			if (m_rx_frame_remaining == 0) {
+				m_rx_header_count = 0;
+				message_complete = true;
+			}
+		}
+	}
+	if (m_rx_start == m_rx_end) {
+		m_rx_start = 0;
+		m_rx_end = 0;
 	}
-	if (end_char_received) {
-		return message;
+	return message_complete;
+}
+
+int Port::ReadRxFifo(void) {
+	// Called once ConsumeRxBuffer() has emptied the receive buffer. The remainder of a large length-prefixed message body is read straight
+	// into m_current_message rather than passing through the receive buffer.
+	int status = 0;
+	if ((m_framing == framing_mode::length_prefix) && (m_rx_header_count == sizeof(uint32_t)) && (m_rx_frame_remaining >= m_rx_buffer.size())) {
+		status = ReadRx(&m_current_message[m_current_message.size() - m_rx_frame_remaining], m_rx_frame_remaining);
+		if (status > 0) {
+			m_rx_frame_remaining -= (size_t)(status);
+		}
 	} else {
-		return "";
+		status = ReadRx(m_rx_buffer.data(), m_rx_buffer.size());
+		if (status > 0) {
+			m_rx_start = 0;
+			m_rx_end = (size_t)(status);
+		}
+	}
+	return status;
+}
+
+bool Port::HasBufferedMessage(void) {
+	size_t unread_count = m_rx_end - m_rx_start;
+	if (m_rx_bulk_frame) {
+		return (unread_count > 0);                                   // Enough for ReceiveBulk() to carry on with.
+	} else if (m_framing == framing_mode::end_char) {
+		return ((unread_count > 0) && (memchr(m_rx_buffer.data() + m_rx_start, m_end_char, unread_count) != NULL));
+	} else if (m_rx_header_count == sizeof(uint32_t)) {
+		return (unread_count >= m_rx_frame_remaining);
+	} else {
+		size_t header_bytes_needed = sizeof(uint32_t) - m_rx_header_count;
+		if (unread_count < header_bytes_needed) {
+			return false;
+		}
+		char header[sizeof(uint32_t)];
+		memcpy(header, m_rx_header, m_rx_header_count);
+		memcpy(header + m_rx_header_count, m_rx_buffer.data() + m_rx_start, header_bytes_needed);
+		uint32_t frame_length = 0;
+		memcpy(&frame_length, header, sizeof(frame_length));
+		return ((unread_count - header_bytes_needed) >= frame_length);
+	}
+}
+
+bool Port::IsMessageReady(void) {
+	// Non-blocking. Pulls whatever is waiting in the rx fifo into the receive buffer and returns true if the next call to GetMessage()
+	// will return immediately, either with a complete message or with an error (eg the counterpart has disconnected). If it returns false
+	// the Port is ready for the caller to sleep on its rx descriptor.
+	ReleaseDeliveredMessage();
+	if (m_rx_bulk_frame) {
+		// Only ReceiveBulk() may carry on with the frame, so report whether it has anything to carry on with, without reading any of it.
+		struct pollfd poll_descriptor = {m_fifos.in.descriptor, POLLIN, 0};
+		return (HasBufferedMessage() || (poll(&poll_descriptor, 1, 0) > 0));
+	}
+	while (true) {
+		if (HasBufferedMessage()) {
+			return true;
+		}
+		ConsumeRxBuffer(false);
+		
+		int status = ReadRxFifo();
+		
+		if (status > 0) {
+			continue;
+		} else if (status == 0) {               // EOF - GetMessage() will report the disconnection, but only once the handshake has completed.
+			return m_fifos.in.opened;
+		} else if (errno != EAGAIN) {
+			return true;
+		} else if (!PrepareRxWait()) {
+			return false;
+		}
 	}
 }
 
 error_descriptor Port::GetErrorCode(void) {
-	return m_error_code;
+	return DescribeError(m_error);
+}
+
+error_state Port::GetErrorState(void) {
+	return m_error;
+}
+
+error_descriptor Port::DescribeError(error_state const& error) {
+	std::string context = (error.context != NULL) ? error.context : "";
+	std::string detail = "";
+	switch (error.type) {
+		case error_type::none:                            detail = ""; break;
+		case error_type::mkfifo:                          detail = "mkfifo()"; break;
+		case error_type::open_rx:                         detail = "open()_rx"; break;
+		case error_type::open_tx:                         detail = "open()_tx"; break;
+		case error_type::invalid_init:                    detail = "OpenSession()_invalid_init"; break;
+		case error_type::message_too_long:                detail = "SendMessage()_message_too_long"; break;
+		case error_type::write:                           detail = "write()"; break;
+		case error_type::write_thread_block:              detail = "write()_thread_block"; break;
+		case error_type::write_thread_block_timeout:      detail = "write()_thread_block_timeout"; break;
+		case error_type::read:                            detail = "read()"; break;
+		case error_type::read_eof:                        detail = "read()_EOF"; break;
+		case error_type::tx_conn_timeout:                 detail = "GetMessage()_tx_conn_timeout"; break;
+		case error_type::tx_unconn_timeout:               detail = "GetMessage()_tx_unconn_timeout"; break;
+		case error_type::epoll_create1:                   detail = "epoll_create1()"; break;
+		case error_type::epoll_ctl:                       detail = "epoll_ctl()"; break;
+		case error_type::epoll_wait:                      detail = "epoll_wait()"; break;
+		case error_type::oor_port_id:                     detail = context + "_OOR_port_id"; break;
+		case error_type::oor_port_handle:                 detail = context + "_OOR_port_handle"; break;
+		case error_type::invalid_args:                    detail = "GetArgStartIndex()_invalid_args"; break;
+		case error_type::getcwd:                          detail = "getcwd()"; break;
+		case error_type::spawn:                           detail = "posix_spawn()"; break;
+		case error_type::no_terminal_emulator:            detail = "no_terminal_emulator" + context; break;
+		case error_type::mkdir:                           detail = "mkdir()"; break;
+		case error_type::no_terminal_emulator_paths_file: detail = "no_terminal_emulator_paths_file" + context; break;
+		case error_type::tx_queue_full:                   detail = "SendMessage()_tx_queue_full"; break;
+		case error_type::eventfd:                         detail = "eventfd()"; break;
+		case error_type::io_thread:                       detail = "StartIoThread()_thread"; break;
+		case error_type::no_event_loop:                   detail = "co_await_no_event_loop"; break;
+		case error_type::shm_open:                        detail = "shm_open()"; break;
+		case error_type::bulk_output:                     detail = "ReceiveBulk()_output"; break;
+		case error_type::bulk_frame_in_progress:          detail = "GetMessage()_bulk_frame_in_progress"; break;
+		case error_type::socket:                          detail = "socket()"; break;
+		case error_type::connect:                         detail = "connect()"; break;
+		case error_type::no_connected_client:             detail = "Submit()_no_connected_client"; break;
+		case error_type::session_incompatible:            detail = "OpenSession()_incompatible"; break;
+		case error_type::session_timeout:                 detail = "OpenSession()_timeout"; break;
+		case error_type::frame_remainder_mismatch:        detail = "SendMessage()_frame_remainder_mismatch"; break;
+		case error_type::reserved_port_id:                detail = "CreatePorts()_reserved_port_id"; break;
+	}
+	return {error.err_no, detail};
+}
+
+std::string Port::GetIdentifier(void) {
+	return m_identifier;
+}
+
+framing_mode Port::GetFramingMode(void) {
+	return m_framing;
+}
+
+transport_mode Port::GetTransportMode(void) {
+	return m_transport;
+}
+
+int Port::GetRxDescriptor(void) {
+	return m_fifos.in.descriptor;
+}
+
+int Port::GetTxDescriptor(void) {
+	return m_fifos.out.descriptor;
+}
+
+size_t Port::GetPipeSize(bool writable) {
+	// Returns the current capacity of the tx (writable) or rx fifo, or 0 if it is not open.
+	fifo& fifo = writable ? m_fifos.out : m_fifos.in;
+	int pipe_size = fifo.opened ? fcntl(fifo.descriptor, F_GETPIPE_SZ) : -1;
+	return (pipe_size < 0) ? 0 : (size_t)(pipe_size);
+}
+
+size_t Port::GetUnreadBytes(void) {
+	// Returns the number of bytes sent that the counterpart has yet to read, a measure of how far behind it is. For a fifo this is what
+	// FIONREAD reports for the pipe, for a socket what SIOCOUTQ reports (which counts the kernel's per-record overhead too).
+	if (!m_fifos.out.opened) {
+		return 0;
+	}
+	if (m_transport == transport_mode::shared_memory) {
+		return m_tx_ring.GetUsed();
+	}
+	int byte_count = 0;
+	unsigned long request = (m_transport == transport_mode::seqpacket) ? SIOCOUTQ : FIONREAD;
+	if (ioctl(m_fifos.out.descriptor, request, &byte_count) < 0) {
+		return 0;
+	}
+	return (size_t)(byte_count);
 }
 
 bool Port::IsOpened(void) {
@@ -11,36 +11,153 @@
 // -----------------------------------------------------------------------------------------------------
 
 #include <string>                    // std::string.
+#include <string_view>               // std::string_view.
 #include <vector>                    // std::vector.
+#include <chrono>                    // std::chrono::steady_clock.
+#include <cstdint>                   // uint32_t.
+#include <atomic>                    // std::atomic.
+
+#include <sys/uio.h>                 // struct iovec.
+#include <sys/socket.h>              // socklen_t.
+#include <sys/un.h>                  // struct sockaddr_un.
 
 #include "satterm_struct.h"
+#include "satterm_sync.h"
+#include "satterm_shm.h"
+
+// All timeouts are measured against the monotonic steady_clock, so they are unaffected by wall-clock (NTP) adjustments.
+typedef std::chrono::steady_clock satterm_clock;
+typedef satterm_clock::duration satterm_duration;
+typedef satterm_clock::time_point satterm_deadline;
+
+// How far opening a Port has got. See Port::StartOpen().
+enum class open_step {
+	pending,                                                       // Waiting for the session handshake to complete it.
+	opened,
+	failed
+};
 
 class Port {
 	public:
-		Port(bool is_server, std::string const& working_path, std::string const& identifier, bool display_messages, char end_char);
+		Port(bool is_server, std::string const& working_path, std::string const& identifier, bool display_messages, char end_char,
+		     port_options const& options = port_options());
 		~Port();
 		
 		bool IsOpened(void);
+		bool IsMessageReady(void);
+		bool PrepareRxWait(void);
+		bool HasBufferedMessage(void);
 		std::string GetMessage(bool capture_end_char, unsigned long timeout_seconds);
+		std::string GetMessage(bool capture_end_char, satterm_deadline deadline);
+		std::string_view GetMessageView(bool capture_end_char, unsigned long timeout_seconds);
+		std::string_view GetMessageView(bool capture_end_char, satterm_deadline deadline);
+		size_t GetMessages(std::vector<std::string>& messages, size_t max_count, bool capture_end_char, unsigned long timeout_seconds);
+		size_t GetMessages(std::vector<std::string>& messages, size_t max_count, bool capture_end_char, satterm_deadline deadline);
 		std::string SendMessage(std::string const& message, unsigned long timeout_seconds);
+		std::string SendMessage(std::string const& message, satterm_deadline deadline);
+		size_t SendMessage(std::vector<std::string_view> const& message_parts, unsigned long timeout_seconds);
+		size_t SendMessage(std::vector<std::string_view> const& message_parts, satterm_deadline deadline);
+		size_t SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, unsigned long timeout_seconds);
+		size_t SendMessages(std::vector<std::string> const& messages, std::string& remaining_message, satterm_deadline deadline);
 		size_t SendBytes(const char* bytes, size_t byte_count, unsigned long timeout_seconds);
+		size_t SendBytes(const char* bytes, size_t byte_count, satterm_deadline deadline);
+		bool FlushTx(satterm_deadline deadline);
+		size_t SendBulk(const char* bytes, size_t byte_count, unsigned long timeout_seconds);
+		size_t SendBulk(const char* bytes, size_t byte_count, satterm_deadline deadline);
+		size_t ReceiveBulk(int descriptor, unsigned long timeout_seconds);
+		size_t ReceiveBulk(int descriptor, satterm_deadline deadline);
 		error_descriptor GetErrorCode(void);
+		error_state GetErrorState(void);
+		std::string GetIdentifier(void);
+		framing_mode GetFramingMode(void);
+		transport_mode GetTransportMode(void);
+		int GetRxDescriptor(void);
+		int GetTxDescriptor(void);
+		size_t GetPipeSize(bool writable);
+		size_t GetUnreadBytes(void);
+		bool CompleteServerOpen(bool shared_memory);
+		bool CompleteClientOpen(framing_mode framing, std::string const& shm_name);
+		bool ReceiveHandshake(std::string& message, satterm_deadline deadline);
+		std::string GetSharedMemoryName(void);
+		
+		static satterm_duration SecondsToDuration(unsigned long timeout_seconds);
+		static satterm_deadline DeadlineAfter(satterm_duration timeout);
+		static error_descriptor DescribeError(error_state const& error);
+		static size_t WriteToDescriptor(int descriptor, const char* bytes, size_t byte_count, satterm_deadline deadline, int& err_no);
 		
 	protected:
 		bool CreateFifo(std::string const& fifo_path);
-		bool OpenFifos(bool is_server, unsigned long timeout_seconds);
-		bool OpenRxFifo(std::string const& fifo_path, unsigned long timeout_seconds);
-		bool OpenTxFifo(std::string const& fifo_path, unsigned long timeout_seconds);
-		int PollToOpenTxFifo(std::string const& fifo_path, unsigned long timeout_seconds);
+		void StartOpen(bool is_server, port_options const& options);
+		void FinishOpen(framing_mode framing);
+		bool FailOpen(void);
+		bool OpenRxFifo(void);
+		bool OpenTxFifo(void);
+		bool CreateSharedMemory(size_t ring_size);
+		bool OpenSharedMemory(std::string const& shm_name);
+		void StartSharedMemory(bool is_server);
+		bool ListenSocket(void);
+		bool AcceptSocket(void);
+		bool ConnectSocket(void);
+		socklen_t GetSocketAddress(struct sockaddr_un& address);
+		void SizePipes(port_options const& options);
+		size_t SetPipeSize(int descriptor, size_t pipe_size);
+		bool GrowTxPipe(void);
+		static size_t GetPipeMaxSize(void);
+		size_t SendFrame(std::string_view const* message_parts, size_t part_count, satterm_deadline deadline);
+		bool SendAtomicFrame(std::string_view const* message_parts, size_t part_count, size_t message_length, satterm_deadline deadline,
+		                     size_t& message_bytes_sent);
+		size_t SendFrameLocked(std::string_view const* message_parts, size_t part_count, size_t message_length, satterm_deadline deadline,
+		                       bool map_pages = false);
+		bool CommitFrame(size_t frame_bytes_sent, size_t message_length, bool has_header, size_t& message_bytes_sent);
+		bool IsTxFrameOpen(void);
+		size_t SendIovecs(struct iovec* iovecs, size_t iovec_count, satterm_deadline deadline, bool map_pages = false);
+		ssize_t WriteTx(struct iovec const* iovecs, int iovec_count, bool map_pages = false);
+		ssize_t ReadRx(char* buffer, size_t size);
+		bool SpinForRx(satterm_deadline deadline);
+		ssize_t DrainRxFifo(void);
+		bool ReceiveMessage(bool capture_end_char, satterm_deadline deadline, std::string_view& message);
+		bool WaitForRx(int status, satterm_deadline start_time, satterm_deadline deadline);
+		bool TakeBufferedMessage(bool capture_end_char, std::string_view& message);
+		bool ConsumeRxBuffer(bool capture_end_char);
+		void ReleaseDeliveredMessage(void);
+		int ReadRxFifo(void);
+		static bool WaitForDescriptor(int descriptor, short events, satterm_deadline deadline, satterm_duration max_wait = satterm_duration::zero());
 		void CloseFifos(void);
-		void UnlinkInFifo(void);
+		void UnlinkFifos(void);
 		
-		error_descriptor m_error_code = {0, ""};
+		SatTerm_ErrorCell m_error;
 		bool m_display_messages = false;
 		std::string m_identifier = "";
 		std::string m_working_path = "";
 		char m_end_char = 0;
-		fifo_pair m_fifos = {{"", false, false, 0}, {"", false, false, 0}};
+		fifo_pair m_fifos = {{"", false, false, -1}, {"", false, false, -1}};
 		std::string m_current_message = "";
+		bool m_rx_message_delivered = false;
+		std::vector<char> m_rx_buffer = {};
+		size_t m_rx_start = 0;
+		size_t m_rx_end = 0;
+		framing_mode m_framing = framing_mode::end_char;
+		char m_rx_header[sizeof(uint32_t)] = {};
+		size_t m_rx_header_count = 0;
+		size_t m_rx_frame_remaining = 0;
+		bool m_rx_bulk_frame = false;                                // ReceiveBulk() stopped part-way through a body that only it may finish.
+		std::string m_tx_pending_prefix = "";
+		size_t m_tx_frame_remaining = 0;
+		std::vector<struct iovec> m_tx_iovecs = {};
+		std::vector<uint32_t> m_tx_frame_lengths = {};
+		bool m_tx_frame_open = false;                                // An end char framed message was part-sent (its remainder is owed).
+		SatTerm_SendSequencer m_tx_sequencer;
+		transport_mode m_transport = transport_mode::fifo;
+		SatTerm_SharedMemory m_shm;
+		SatTerm_SharedRing m_tx_ring = {};
+		SatTerm_SharedRing m_rx_ring = {};
+		satterm_duration m_ring_spin = satterm_duration::zero();
+		int m_socket_descriptor = -1;                                 // With seqpacket transport, both m_fifos share this descriptor.
+		std::atomic<bool> m_adaptive_pipe_size = {false};
+		std::atomic<uint32_t> m_tx_block_count = {0};               // Sends that found the tx fifo full, for adaptive pipe sizing.
+		bool m_is_server = false;
+		port_options m_options = {};
+		open_step m_open_step = open_step::failed;
+		int m_listen_descriptor = -1;
 		
 };
@@ -0,0 +1,115 @@
+// -----------------------------------------------------------------------------------------------------
+// satellite_terminal - Easily spawn and communicate bidirectionally with client processes in separate
+//                      terminal emulator instances.
+// -----------------------------------------------------------------------------------------------------
+// seb.nf.sikora@protonmail.com
+//
+// Copyright © 2021 Dr Seb N.F. Sikora.
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+// -----------------------------------------------------------------------------------------------------
+
+#include <string>                    // std::string.
+#include <vector>                    // std::vector.
+#include <atomic>                    // std::atomic.
+#include <utility>                   // std::swap.
+
+// Lock-free bounded ring queue for exactly one producer thread and one consumer thread.
+//
+// Items are swapped in and out of their slots rather than copied, so a slot keeps the storage of whatever it last held. With
+// std::string payloads, pushing and popping in steady state therefore reuses existing buffers instead of allocating.
+template <typename T>
+class SatTerm_Queue {
+	public:
+		SatTerm_Queue(size_t capacity) {
+			size_t slot_count = 1;
+			while (slot_count < capacity) {
+				slot_count <<= 1;
+			}
+			m_slots.resize(slot_count);
+			m_mask = slot_count - 1;
+		}
+		
+		// Producer only. Swaps item into the queue, leaving item holding the previous (spent) contents of the slot.
+		bool Push(T& item) {
+			size_t tail = m_tail.load(std::memory_order_relaxed);
+			if (tail - m_cached_head > m_mask) {
+				m_cached_head = m_head.load(std::memory_order_acquire);
+				if (tail - m_cached_head > m_mask) {
+					return false;
+				}
+			}
+			std::swap(m_slots[tail & m_mask], item);
+			m_tail.store(tail + 1, std::memory_order_release);
+			return true;
+		}
+		
+		// Consumer only. Swaps the oldest item out of the queue into item, leaving the previous contents of item in the slot for reuse.
+		bool Pop(T& item) {
+			size_t head = m_head.load(std::memory_order_relaxed);
+			if (head == m_cached_tail) {
+				m_cached_tail = m_tail.load(std::memory_order_acquire);
+				if (head == m_cached_tail) {
+					return false;
+				}
+			}
+			std::swap(m_slots[head & m_mask], item);
+			m_head.store(head + 1, std::memory_order_release);
+			return true;
+		}
+		
+		// Either thread. The answer may be stale by the time it is acted upon, but only in the safe direction for the calling side.
+		bool IsEmpty(void) const {
+			return (m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire));
+		}
+		
+		bool IsFull(void) const {
+			return ((m_tail.load(std::memory_order_acquire) - m_head.load(std::memory_order_acquire)) > m_mask);
+		}
+		
+		// Producer only.
+		size_t GetFreeCount(void) const {
+			return (m_mask + 1) - (m_tail.load(std::memory_order_relaxed) - m_head.load(std::memory_order_acquire));
+		}
+	
+	private:
+		std::vector<T> m_slots = {};
+		size_t m_mask = 0;
+		alignas(64) std::atomic<size_t> m_head = {0};        // Written only by the consumer.
+		size_t m_cached_tail = 0;                            // Consumer's last view of m_tail.
+		alignas(64) std::atomic<size_t> m_tail = {0};        // Written only by the producer.
+		size_t m_cached_head = 0;                            // Producer's last view of m_head.
+};
+
+// An entry in a Port's outbound or inbound queue when the agent is running an I/O thread.
+struct queued_message {
+	std::string message;
+	bool raw_bytes;                  // Outbound only. Send message as-is, with no framing (see SendBytes()).
+	error_state error;               // Inbound only. If set, the Port failed after the preceding messages and message is empty.
+};
+
+// Per-Port state shared between the application thread and the agent's I/O thread.
+struct io_port {
+	io_port(size_t queue_capacity) : outbound(queue_capacity), inbound(queue_capacity) {}
+	
+	SatTerm_Queue<queued_message> outbound;
+	SatTerm_Queue<queued_message> inbound;
+	std::atomic<bool> opened = {true};
+	std::atomic<bool> rx_blocked = {false};                  // The I/O thread has stopped reading because inbound is full.
+	error_state error = {error_type::none, 0};               // Written by the I/O thread before it clears opened.
+	
+	// Used only by the I/O thread.
+	queued_message tx_item = {"", false, {error_type::none, 0}};
+	queued_message rx_item = {"", false, {error_type::none, 0}};
+	bool tx_in_flight = false;
+	bool tx_framing_owed = false;                            // tx_item was sent but for its end char, which FlushTx() must send.
+	size_t tx_offset = 0;
+	bool error_pending = false;
+	std::vector<std::string> rx_messages = {};
+	
+	// Used only by the application side. Sending threads take app_tx_lock to share the (single producer) outbound queue.
+	queued_message app_rx_item = {"", false, {error_type::none, 0}};
+	queued_message app_tx_item = {"", false, {error_type::none, 0}};
+	SatTerm_TicketLock app_tx_lock;
+};
@@ -16,18 +16,46 @@
 #include <map>                        // std::map.
 #include <vector>                     // std::vector.
 #include <memory>                     // std::unique_ptr.
+#include <chrono>                     // std::chrono::seconds, std::chrono::duration_cast.
+#include <sstream>                    // std::istringstream.
+#include <thread>                     // std::this_thread::sleep_for().
 
 #include <errno.h>                    // errno.
-#include <unistd.h>                   // fork(), execl(), getcwd().
+#include <unistd.h>                   // getcwd(), access(), environ.
+#include <spawn.h>                    // posix_spawn(), posix_spawnp(), posix_spawn_file_actions_*().
+#include <fcntl.h>                    // O_RDONLY, O_WRONLY, O_CREAT, O_APPEND.
 #include <stdio.h>                    // perror(), FILENAME_MAX.
+#include <signal.h>                   // kill(), SIGTERM, SIGKILL.
+#include <sys/wait.h>                 // waitpid().
 
 #include "satellite_terminal.h"
 
 SatTerm_Server::SatTerm_Server(std::string const& identifier, std::string const& path_to_client_binary, bool display_messages,
                                std::vector<std::string> port_identifiers, std::string const& stop_message,
                                std::string const& path_to_terminal_emulator_paths, char end_char, std::string const& stop_port_identifier,
-                               unsigned long timeout_seconds) {
-	
+                               unsigned long timeout_seconds, port_options const& options, launch_options const& launch) :
+                               SatTerm_Server(identifier, path_to_client_binary, display_messages, port_identifiers, stop_message,
+                                              path_to_terminal_emulator_paths, end_char, stop_port_identifier, Port::SecondsToDuration(timeout_seconds),
+                                              options, launch) {}
+
+SatTerm_Server::SatTerm_Server(std::string const& identifier, std::string const& path_to_client_binary, bool display_messages,
+                               std::vector<std::string> port_identifiers, std::string const& stop_message,
+                               std::string const& path_to_terminal_emulator_paths, char end_char, std::string const& stop_port_identifier,
+                               satterm_duration timeout, port_options const& options, launch_options const& launch) {
+	bool success = Launch(identifier, path_to_client_binary, display_messages, port_identifiers, stop_message, path_to_terminal_emulator_paths,
+	                      end_char, stop_port_identifier, timeout, options, launch);
+	if (success) {
+		success = OpenSession(true, Port::DeadlineAfter(timeout), options);
+	}
+	FinishConnecting(success);
+}
+
+bool SatTerm_Server::Launch(std::string const& identifier, std::string const& path_to_client_binary, bool display_messages,
+                            std::vector<std::string> port_identifiers, std::string const& stop_message,
+                            std::string const& path_to_terminal_emulator_paths, char end_char, std::string const& stop_port_identifier,
+                            satterm_duration timeout, port_options const& options, launch_options const& launch) {
+	// Creates the Ports and starts the client, which then opens its ends of them. OpenSession() completes the connection once the client's
+	// hello arrives, and FinishConnecting() reports the outcome.
 	m_identifier = identifier;
 	m_display_messages = display_messages;
 	m_end_char = end_char;
@@ -42,35 +70,46 @@ SatTerm_Server::SatTerm_Server(std::string const& identifier, std::string const&
 		m_stop_port_identifier = m_default_port_identifier;
 	}
 	
-	m_working_path = GetWorkingPath();
-	
-	bool success = true;
-	if (m_working_path != "") {
-		
-		if (success) {
-			pid_t client_pid = StartClient(path_to_terminal_emulator_paths, path_to_client_binary, m_working_path, m_end_char, m_stop_message, port_identifiers);
-			if (client_pid < 0) {
-				success = false;
-			}
+	if (launch.fifo_directory != "") {
+		m_working_path = launch.fifo_directory;
+		if (m_working_path.back() != '/') {
+			m_working_path += "/";
 		}
-		
-		if (success) {
-			success = CreatePorts(true, m_working_path, port_identifiers, m_display_messages, m_end_char, m_ports);
+	} else {
+		m_working_path = GetWorkingPath();
+	}
+	
+	bool success = (m_working_path != "");
+	
+	// The Ports are created before the client is started, so that it finds them ready to open (see Port::StartOpen()).
+	if (success) {
+		success = CreatePorts(true, m_working_path, port_identifiers, m_display_messages, m_end_char, options, m_ports);
+	}
+	
+	if (success) {
+		m_client_pid = StartClient(path_to_terminal_emulator_paths, path_to_client_binary, m_working_path, m_end_char, m_stop_message, port_identifiers,
+		                           options.transport, timeout, launch);
+		if (m_client_pid < 0) {
+			success = false;
 		}
-		
-		if (success) {
-			if (m_display_messages) {
-				std::string message = "Server " + m_identifier + " successfully initialised connection.";
-				std::cerr << message << std::endl;
-			}
-		} else {
-			if (m_display_messages) {
-				std::string message = "Server " + m_identifier + " unable to intialise connection.";
-				std::cerr << message << std::endl;
-			}
+	}
+	return success;
+}
+
+void SatTerm_Server::FinishConnecting(bool success) {
+	if (success) {
+		if (m_display_messages) {
+			std::string message = "Server " + m_identifier + " successfully initialised connection.";
+			std::cerr << message << std::endl;
 		}
 	} else {
-		success = false;
+		if (m_display_messages) {
+			std::string message = "Server " + m_identifier + " unable to intialise connection.";
+			std::cerr << message << std::endl;
+		}
+		if (m_client_pid > 0) {
+			kill(m_client_pid, SIGTERM);                            // Rather than leave a client stuck in its handshake. The destructor reaps it.
+		}
 	}
 	SetConnectedFlag(success);
 }
@@ -82,24 +121,48 @@ SatTerm_Server::~SatTerm_Server() {
 			std::cerr << "Waiting for client process to terminate..." << std::endl;
 		}
 		
-		unsigned long start_time = time(0);
-		unsigned long shutdown_confirmation_timeout = 5;
-		while(IsConnected() && ((time(0) - start_time) < shutdown_confirmation_timeout)) {
-			std::string shutdown_confirmation = GetMessage(m_stop_port_identifier, false, 0);
+		satterm_deadline shutdown_confirmation_deadline = Port::DeadlineAfter(std::chrono::seconds(5));
+		while(IsConnected() && (satterm_clock::now() < shutdown_confirmation_deadline)) {
+			std::string shutdown_confirmation = GetMessage(m_stop_port_identifier, false, shutdown_confirmation_deadline);
 			if (shutdown_confirmation == m_stop_message) {
 				break;
 			}
 		}
 	}
+	
+	// The client exits once it sees its Ports close, so they are closed before it is waited for.
+	ClosePorts();
+	ReapClient(Port::DeadlineAfter(CLIENT_EXIT_WAIT));
+}
+
+void SatTerm_Server::ReapClient(satterm_deadline deadline) {
+	// Waits until deadline for the client process to exit, then kills it, so that it never lingers as a zombie (or at all).
+	if ((m_client_pid <= 0) || m_client_reaped) {
+		return;
+	}
+	pid_t status = waitpid(m_client_pid, NULL, WNOHANG);
+	while ((status == 0) && (satterm_clock::now() < deadline)) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		status = waitpid(m_client_pid, NULL, WNOHANG);
+	}
+	if (status == 0) {
+		if (m_display_messages) {
+			std::string message = "Client process " + std::to_string(m_client_pid) + " did not exit, killing it.";
+			std::cerr << message << std::endl;
+		}
+		kill(m_client_pid, SIGKILL);
+		waitpid(m_client_pid, NULL, 0);
+	}
+	m_client_reaped = true;
 }
 
 std::string SatTerm_Server::GetWorkingPath(void) {
-	m_error_code = {0, ""};
+	m_error = {error_type::none, 0};
 	
 	char working_path[FILENAME_MAX + 1];
 	char* retval = getcwd(working_path, FILENAME_MAX + 1);
 	if (retval == NULL) {
-		m_error_code = {errno, "getcwd()"};
+		m_error = {error_type::getcwd, errno};
 		if (m_display_messages) {
 			perror("getcwd() unable to obtain current working path");
 		}
@@ -117,68 +180,121 @@ std::string SatTerm_Server::GetWorkingPath(void) {
 }
 
 pid_t SatTerm_Server::StartClient(std::string const& path_to_terminal_emulator_paths, std::string const& path_to_client_binary, std::string const& working_path,
-                                  char end_char, std::string const& stop_message, std::vector<std::string> port_identifiers) {
-	m_error_code = {0, ""};
+                                  char end_char, std::string const& stop_message, std::vector<std::string> port_identifiers, transport_mode transport,
+                                  satterm_duration timeout, launch_options const& launch) {
+	m_error = {error_type::none, 0};
 	
-	std::vector<std::string> terminal_emulator_paths = LoadTerminalEmulatorPaths(path_to_terminal_emulator_paths);
+	// posix_spawn() starts the client without duplicating this process's page tables as fork() would, so launching stays cheap however
+	// large the server grows. It also reports a failed exec here, in the server, rather than leaving a child process to exit.
+	std::string terminal_path = "";
+	if (launch.mode == launch_mode::terminal_emulator) {
+		terminal_path = FindTerminalEmulator(path_to_terminal_emulator_paths);
+		if (terminal_path == "") {
+			return -1;
+		}
+	}
 	
-	pid_t process;
-	if (terminal_emulator_paths.size() > 0) {
-		process = fork();
-		if (process < 0) {        // fork() failed.
-			// Info on possible fork() errors - https://pubs.opengroup.org/onlinepubs/009696799/functions/fork.html
-			m_error_code = {errno, "fork()"};
-			if (m_display_messages) {
-				perror("fork() to client process failed");
-			}
-			return process;
+	// Assemble command string to be passed to terminal emulator.
+	std::string arg_string = path_to_client_binary;
+	arg_string += " client_args";    // Argument start delimiter.
+	arg_string += " " + working_path;
+	arg_string += " ";
+	arg_string += std::to_string((int)(end_char));
+	arg_string += " " + stop_message;
+	arg_string += " ";
+	arg_string += std::to_string(port_identifiers.size());
+	
+	for (const auto& identifier : port_identifiers) {
+		arg_string += " " + identifier;
+	}
+	
+	// The client can only find its Ports if it knows where to look. Every other transport starts out on the fifos.
+	if (transport == transport_mode::seqpacket) {
+		arg_string += " seqpacket";
+	}
+	// The client waits for its Ports as long as the server does.
+	arg_string += " timeout_ms=" + std::to_string(std::chrono::duration_cast<std::chrono::milliseconds>(timeout).count());
+	
+	std::vector<std::string> args = {};
+	posix_spawn_file_actions_t file_actions;
+	posix_spawn_file_actions_init(&file_actions);
+	if (launch.mode == launch_mode::headless) {
+		// The command string is split on spaces into the same arguments the terminal emulator would have passed the client, which is then
+		// executed directly. With no window to write to, its stdout and stderr go to output_path, and it reads from /dev/null.
+		std::istringstream arg_stream(arg_string);
+		std::string arg = "";
+		while (arg_stream >> arg) {
+			args.push_back(arg);
 		}
-		if (process == 0) {       // We are in the child process!
-			if (m_display_messages) {
-				std::string message = "Client process started.";
-				std::cerr << message << std::endl;
-			}
-			
-			// Assemble command string to be passed to terminal emulator.
-			std::string arg_string = path_to_client_binary;
-			arg_string += " client_args";    // Argument start delimiter.
-			arg_string += " " + working_path;
-			arg_string += " " + std::to_string((int)(end_char));
-			arg_string += " " + stop_message;
-			arg_string += " " + std::to_string(port_identifiers.size());
-			
-			for (const auto& identifier : port_identifiers) {
-				arg_string += " " + identifier;
-			}
-			
-			if (m_display_messages) {
-				std::cerr << "Client process attempting to execute via terminal emulator '-e':" << std::endl << arg_string << std::endl;
-			}
-			
-			for (const auto terminal_path : terminal_emulator_paths) {
-				// No need to check execl() return value. If it returns, you know it failed.
-				if (m_display_messages) {
-					std::cerr << "Trying " << terminal_path << std::endl;
-				}
-				execl(terminal_path.c_str(), terminal_path.c_str(), "-e", arg_string.c_str(), (char*) NULL);
-			}
-			
-			if (m_display_messages) {
-				// No point storing m_error_code, we are in the child process...
-				std::string error_string = "Client process execl() failed to start client binary. Check terminal_emulator_paths.txt";
-				perror(error_string.c_str());
-			}
-			std::exit(1);    // Have to exit(1) here to terminate client process if we couldn't start a terminal emulator.
-			return -1;
+		posix_spawn_file_actions_addopen(&file_actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+		posix_spawn_file_actions_addopen(&file_actions, STDOUT_FILENO, launch.output_path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+		posix_spawn_file_actions_adddup2(&file_actions, STDOUT_FILENO, STDERR_FILENO);
+		if (m_display_messages) {
+			std::cerr << "Client process attempting to execute headless, output to " << launch.output_path << ":" << std::endl << arg_string << std::endl;
 		}
 	} else {
+		args = {terminal_path, "-e", arg_string};
+		if (m_display_messages) {
+			std::cerr << "Client process attempting to execute via terminal emulator " << terminal_path << " '-e':" << std::endl << arg_string << std::endl;
+		}
+	}
+	std::vector<char*> argv = {};
+	for (auto& arg : args) {
+		argv.push_back(&arg[0]);
+	}
+	argv.push_back(NULL);
+	
+	// posix_spawnp() searches PATH for a bare client binary name, as a terminal emulator's shell would.
+	pid_t process = -1;
+	int status = (launch.mode == launch_mode::headless) ? posix_spawnp(&process, argv[0], &file_actions, NULL, argv.data(), environ)
+	                                                    : posix_spawn(&process, argv[0], &file_actions, NULL, argv.data(), environ);
+	posix_spawn_file_actions_destroy(&file_actions);
+	
+	if (status != 0) {
+		m_error = {error_type::spawn, status};
+		if (m_display_messages) {
+			errno = status;
+			std::string error_string = "posix_spawn() unable to start client process " + args[0];
+			perror(error_string.c_str());
+		}
 		return -1;
 	}
-    return process;
+	if (m_display_messages) {
+		std::string message = "Client process started with pid " + std::to_string(process) + ".";
+		std::cerr << message << std::endl;
+	}
+	return process;
+}
+
+std::string SatTerm_Server::FindTerminalEmulator(std::string const& path_to_terminal_emulator_paths) {
+	// Returns the first executable terminal emulator listed in the paths file, or "" if there is none.
+	std::vector<std::string> terminal_emulator_paths = LoadTerminalEmulatorPaths(path_to_terminal_emulator_paths);
+	if (m_error.Get().type != error_type::none) {
+		return "";
+	}
+	for (const auto& terminal_path : terminal_emulator_paths) {
+		if ((terminal_path != "") && (access(terminal_path.c_str(), X_OK) == 0)) {
+			return terminal_path;
+		}
+		if (m_display_messages) {
+			std::cerr << "Skipping " << terminal_path << ", not executable" << std::endl;
+		}
+	}
+	m_error_context = path_to_terminal_emulator_paths;
+	m_error = {error_type::no_terminal_emulator, -1, m_error_context.c_str()};
+	if (m_display_messages) {
+		std::cerr << "Server found no executable terminal emulator in " << path_to_terminal_emulator_paths << std::endl;
+	}
+	return "";
+}
+
+pid_t SatTerm_Server::GetClientPid(void) {
+	// The client process started by the constructor (with a terminal emulator, the emulator's process), or -1 if none was started.
+	return m_client_pid;
 }
 
 std::vector<std::string> SatTerm_Server::LoadTerminalEmulatorPaths(std::string const& file_path) {
-	m_error_code = {0, ""};
+	m_error = {error_type::none, 0};
 	
 	std::vector<std::string> terminal_emulator_paths = {};
 	std::ifstream data_file (file_path);
@@ -190,7 +306,8 @@ std::vector<std::string> SatTerm_Server::LoadTerminalEmulatorPaths(std::string c
 		}
 		data_file.close();
 	} else {
-		m_error_code = {-1, "no_terminal_emulator_paths_file" + file_path};
+		m_error_context = file_path;
+		m_error = {error_type::no_terminal_emulator_paths_file, -1, m_error_context.c_str()};
 		if (m_display_messages) {
 			std::cerr << "Server unable to open terminal emulator paths file at " << file_path << std::endl;
 		}
@@ -0,0 +1,229 @@
+// -----------------------------------------------------------------------------------------------------
+// satellite_terminal - Easily spawn and communicate bidirectionally with client processes in separate
+//                      terminal emulator instances.
+// -----------------------------------------------------------------------------------------------------
+// seb.nf.sikora@protonmail.com
+//
+// Copyright © 2021 Dr Seb N.F. Sikora.
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+// -----------------------------------------------------------------------------------------------------
+
+#include <string>                     // std::string, std::to_string.
+#include <atomic>                     // std::atomic, std::atomic_thread_fence.
+#include <cstring>                    // memcpy().
+
+#include <sys/mman.h>                 // shm_open(), shm_unlink(), mmap(), munmap().
+#include <sys/stat.h>                 // fstat(), S_IRUSR, S_IWUSR.
+#include <fcntl.h>                    // O_RDWR, O_CREAT, O_EXCL.
+#include <unistd.h>                   // ftruncate(), close(), getpid().
+#include <errno.h>                    // errno.
+
+#include "satterm_shm.h"
+
+// Layout of a segment. The header and both control blocks share the first page, followed by the data of each ring in turn.
+static const uint32_t SEGMENT_MAGIC = 0x52545353;           // "SSTR".
+static const size_t CONTROL_OFFSET = 256;
+static const size_t DATA_OFFSET = 4096;
+static const size_t MIN_RING_SIZE = 4096;
+
+struct shm_segment_header {
+	uint32_t magic;
+	uint64_t ring_capacity;
+};
+
+static_assert(sizeof(shm_segment_header) <= CONTROL_OFFSET, "Segment header overlaps the control blocks.");
+static_assert((CONTROL_OFFSET + (2 * sizeof(shm_ring_control))) <= DATA_OFFSET, "Control blocks overlap the ring data.");
+
+size_t SatTerm_SharedRing::Write(struct iovec const* iovecs, size_t iovec_count) {
+	// Copies as many bytes from iovecs as there is room for, in order, and publishes them all at once. Returns the number of bytes copied.
+	uint64_t head = m_control->head.load(std::memory_order_relaxed);
+	uint64_t space = m_capacity - (head - m_control->tail.load(std::memory_order_acquire));
+	size_t bytes_written = 0;
+	for (size_t i = 0; (i < iovec_count) && (space > 0); i ++) {
+		const char* source = (const char*)(iovecs[i].iov_base);
+		size_t source_count = (iovecs[i].iov_len < space) ? iovecs[i].iov_len : (size_t)(space);
+		while (source_count > 0) {
+			uint64_t offset = (head + bytes_written) & (m_capacity - 1);
+			size_t chunk = ((m_capacity - offset) < source_count) ? (size_t)(m_capacity - offset) : source_count;
+			memcpy(m_data + offset, source, chunk);
+			source += chunk;
+			source_count -= chunk;
+			bytes_written += chunk;
+			space -= chunk;
+		}
+	}
+	if (bytes_written > 0) {
+		m_control->head.store(head + bytes_written, std::memory_order_release);
+	}
+	return bytes_written;
+}
+
+size_t SatTerm_SharedRing::Read(char* buffer, size_t size) {
+	// Copies up to size of the bytes waiting in the ring into buffer and frees their space. Returns the number of bytes copied.
+	uint64_t tail = m_control->tail.load(std::memory_order_relaxed);
+	uint64_t available = m_control->head.load(std::memory_order_acquire) - tail;
+	size_t bytes_read = (available < size) ? (size_t)(available) : size;
+	size_t copied = 0;
+	while (copied < bytes_read) {
+		uint64_t offset = (tail + copied) & (m_capacity - 1);
+		size_t chunk = ((m_capacity - offset) < (bytes_read - copied)) ? (size_t)(m_capacity - offset) : (bytes_read - copied);
+		memcpy(buffer + copied, m_data + offset, chunk);
+		copied += chunk;
+	}
+	if (bytes_read > 0) {
+		m_control->tail.store(tail + bytes_read, std::memory_order_release);
+	}
+	return bytes_read;
+}
+
+bool SatTerm_SharedRing::IsEmpty(void) {
+	return (m_control->head.load(std::memory_order_acquire) == m_control->tail.load(std::memory_order_relaxed));
+}
+
+size_t SatTerm_SharedRing::GetUsed(void) {
+	// Bytes written but not yet read. Either side may ask, so the answer is only a snapshot.
+	return (size_t)(m_control->head.load(std::memory_order_acquire) - m_control->tail.load(std::memory_order_acquire));
+}
+
+// The waiting flags pair with head and tail as in Dekker's algorithm. Each side stores one, then (after a full fence) loads the other,
+// so that either the sleeper sees the new bytes (or space) or the other side sees that it must ring.
+void SatTerm_SharedRing::SetReaderWaiting(void) {
+	m_control->reader_waiting.store(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+bool SatTerm_SharedRing::TakeReaderWaiting(void) {
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	return ((m_control->reader_waiting.load(std::memory_order_relaxed) != 0) && (m_control->reader_waiting.exchange(0) != 0));
+}
+
+void SatTerm_SharedRing::SetWriterWaiting(void) {
+	m_control->writer_waiting.store(1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+bool SatTerm_SharedRing::TakeWriterWaiting(void) {
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	return ((m_control->writer_waiting.load(std::memory_order_relaxed) != 0) && (m_control->writer_waiting.exchange(0) != 0));
+}
+
+SatTerm_SharedMemory::~SatTerm_SharedMemory() {
+	Close();
+	Unlink();
+}
+
+bool SatTerm_SharedMemory::Create(size_t ring_size, int& err_no) {
+	// Ring capacities are rounded up to a power of two so that offsets can be masked rather than divided.
+	uint64_t ring_capacity = MIN_RING_SIZE;
+	while (ring_capacity < ring_size) {
+		ring_capacity <<= 1;
+	}
+	static std::atomic<unsigned int> segment_count = {0};
+	m_name = "/satterm_" + std::to_string(getpid()) + "_" + std::to_string(segment_count.fetch_add(1));
+	
+	int descriptor = shm_open(m_name.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, S_IRUSR | S_IWUSR);
+	if (descriptor < 0) {
+		err_no = errno;
+		return false;
+	}
+	m_linked = true;
+	size_t segment_size = DATA_OFFSET + (2 * ring_capacity);
+	if (ftruncate(descriptor, (off_t)(segment_size)) < 0) {
+		err_no = errno;
+		close(descriptor);
+		Unlink();
+		return false;
+	}
+	if (!Map(descriptor, segment_size, err_no)) {
+		Unlink();
+		return false;
+	}
+	
+	// The new segment reads as zeroes, so the rings start out empty with nobody waiting.
+	shm_segment_header* header = (shm_segment_header*)(m_address);
+	header->ring_capacity = ring_capacity;
+	header->magic = SEGMENT_MAGIC;
+	m_ring_capacity = ring_capacity;
+	return true;
+}
+
+bool SatTerm_SharedMemory::Open(std::string const& name, int& err_no) {
+	m_name = name;
+	int descriptor = shm_open(m_name.c_str(), O_RDWR | O_CLOEXEC, 0);
+	if (descriptor < 0) {
+		err_no = errno;
+		return false;
+	}
+	struct stat segment_stat = {};
+	if (fstat(descriptor, &segment_stat) < 0) {
+		err_no = errno;
+		close(descriptor);
+		return false;
+	}
+	if (!Map(descriptor, (size_t)(segment_stat.st_size), err_no)) {
+		return false;
+	}
+	
+	shm_segment_header* header = (shm_segment_header*)(m_address);
+	uint64_t ring_capacity = header->ring_capacity;
+	bool power_of_two = ((ring_capacity >= MIN_RING_SIZE) && ((ring_capacity & (ring_capacity - 1)) == 0));
+	if ((header->magic != SEGMENT_MAGIC) || !power_of_two || ((DATA_OFFSET + (2 * ring_capacity)) > m_size)) {
+		err_no = EINVAL;
+		Close();
+		return false;
+	}
+	m_ring_capacity = ring_capacity;
+	shm_unlink(m_name.c_str());                              // Both ends have it mapped now, so the name is no longer needed.
+	return true;
+}
+
+bool SatTerm_SharedMemory::Map(int descriptor, size_t segment_size, int& err_no) {
+	// Closes descriptor either way, as the mapping keeps the segment alive by itself.
+	if (segment_size < DATA_OFFSET) {
+		err_no = EINVAL;
+		close(descriptor);
+		return false;
+	}
+	void* address = mmap(NULL, segment_size, PROT_READ | PROT_WRITE, MAP_SHARED, descriptor, 0);
+	err_no = errno;
+	close(descriptor);
+	if (address == MAP_FAILED) {
+		return false;
+	}
+	m_address = address;
+	m_size = segment_size;
+	err_no = 0;
+	return true;
+}
+
+void SatTerm_SharedMemory::Unlink(void) {
+	// The client unlinks the segment as soon as it has mapped it. This covers a client that never did.
+	if (m_linked) {
+		shm_unlink(m_name.c_str());
+		m_linked = false;
+	}
+}
+
+void SatTerm_SharedMemory::Close(void) {
+	if (m_address != NULL) {
+		munmap(m_address, m_size);
+		m_address = NULL;
+		m_size = 0;
+	}
+}
+
+bool SatTerm_SharedMemory::IsMapped(void) {
+	return (m_address != NULL);
+}
+
+std::string SatTerm_SharedMemory::GetName(void) {
+	return m_name;
+}
+
+SatTerm_SharedRing SatTerm_SharedMemory::GetRing(size_t index) {
+	char* segment = (char*)(m_address);
+	shm_ring_control* control = (shm_ring_control*)(segment + CONTROL_OFFSET) + index;
+	return SatTerm_SharedRing(control, segment + DATA_OFFSET + (index * m_ring_capacity), m_ring_capacity);
+}
@@ -0,0 +1,86 @@
+// -----------------------------------------------------------------------------------------------------
+// satellite_terminal - Easily spawn and communicate bidirectionally with client processes in separate
+//                      terminal emulator instances.
+// -----------------------------------------------------------------------------------------------------
+// seb.nf.sikora@protonmail.com
+//
+// Copyright © 2021 Dr Seb N.F. Sikora.
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+// -----------------------------------------------------------------------------------------------------
+
+#include <string>                    // std::string.
+#include <atomic>                    // std::atomic.
+#include <cstdint>                   // uint32_t, uint64_t.
+
+#include <sys/uio.h>                 // struct iovec.
+
+// Shared between two processes, so these must not need a lock hidden inside the std::atomic.
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "Shared memory rings need lock-free 64 bit atomics.");
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "Shared memory rings need lock-free 32 bit atomics.");
+
+// Control block of one direction of a shared memory segment. head and tail count every byte ever written and read, so the ring is empty
+// when they are equal and full when they differ by its capacity. Each is written by one side only.
+struct shm_ring_control {
+	alignas(64) std::atomic<uint64_t> head;                  // Written by the sending process.
+	alignas(64) std::atomic<uint64_t> tail;                  // Written by the receiving process.
+	alignas(64) std::atomic<uint32_t> reader_waiting;        // Set by a receiver that found the ring empty, cleared by the sender that rings it.
+	std::atomic<uint32_t> writer_waiting;                    // Set by a sender that found the ring full, cleared by the receiver that frees space.
+};
+
+// Single producer, single consumer byte ring in shared memory. Carries exactly the byte stream that would otherwise be written to the
+// fifo, framing included. Only the waiting flags need the fifos (as doorbells), so a busy reader and writer never enter the kernel.
+class SatTerm_SharedRing {
+	public:
+		SatTerm_SharedRing() {}
+		SatTerm_SharedRing(shm_ring_control* control, char* data, uint64_t capacity) : m_control(control), m_data(data), m_capacity(capacity) {}
+		
+		bool IsValid(void) {
+			return (m_control != NULL);
+		}
+		
+		size_t Write(struct iovec const* iovecs, size_t iovec_count);
+		size_t Read(char* buffer, size_t size);
+		bool IsEmpty(void);
+		size_t GetUsed(void);
+		void SetReaderWaiting(void);
+		bool TakeReaderWaiting(void);
+		void SetWriterWaiting(void);
+		bool TakeWriterWaiting(void);
+	
+	private:
+		shm_ring_control* m_control = NULL;
+		char* m_data = NULL;
+		uint64_t m_capacity = 0;
+};
+
+// A POSIX shared memory segment holding a ring for each direction of one Port. The server creates it and names it in its session welcome,
+// and the client maps it during the session handshake.
+class SatTerm_SharedMemory {
+	public:
+		SatTerm_SharedMemory() {}
+		SatTerm_SharedMemory(SatTerm_SharedMemory const&) = delete;
+		SatTerm_SharedMemory& operator=(SatTerm_SharedMemory const&) = delete;
+		~SatTerm_SharedMemory();
+		
+		bool Create(size_t ring_size, int& err_no);
+		bool Open(std::string const& name, int& err_no);
+		void Unlink(void);
+		void Close(void);
+		bool IsMapped(void);
+		std::string GetName(void);
+		SatTerm_SharedRing GetRing(size_t index);
+		
+		static const size_t SERVER_TO_CLIENT = 0;
+		static const size_t CLIENT_TO_SERVER = 1;
+	
+	private:
+		bool Map(int descriptor, size_t segment_size, int& err_no);
+		
+		std::string m_name = "";
+		void* m_address = NULL;
+		size_t m_size = 0;
+		uint64_t m_ring_capacity = 0;
+		bool m_linked = false;
+};
@@ -13,13 +13,13 @@
 struct fifo {
 	std::string identifier;
 	bool created;
-	bool opened;
+	std::atomic<bool> opened;                // Cleared by whichever sending thread finds the fifo broken.
 	int descriptor;
 	
 	fifo& operator=(fifo const& rhs) {
 		identifier = rhs.identifier;
 		created = rhs.created;
-		opened = rhs.opened;
+		opened = rhs.opened.load();
 		descriptor = rhs.descriptor;
 		return *this;
 	}
@@ -52,3 +52,146 @@ struct error_descriptor {
 		return ((this->err_no != rhs.err_no) || (this->err_detail != rhs.err_detail));
 	}
 };
+
+// Where an error arose. Kept as a compact code on the I/O paths and only turned into the descriptive detail string of an
+// error_descriptor when GetErrorCode() is called.
+enum class error_type {
+	none,
+	mkfifo,
+	open_rx,
+	open_tx,
+	invalid_init,
+	message_too_long,
+	write,
+	write_thread_block,
+	write_thread_block_timeout,
+	read,
+	read_eof,
+	tx_conn_timeout,
+	tx_unconn_timeout,
+	epoll_create1,
+	epoll_ctl,
+	epoll_wait,
+	oor_port_id,
+	oor_port_handle,
+	invalid_args,
+	getcwd,
+	spawn,
+	no_terminal_emulator,
+	mkdir,
+	no_terminal_emulator_paths_file,
+	tx_queue_full,
+	eventfd,
+	io_thread,
+	no_event_loop,
+	shm_open,
+	bulk_output,
+	bulk_frame_in_progress,
+	socket,
+	connect,
+	no_connected_client,
+	session_incompatible,
+	session_timeout,
+	reserved_port_id,
+	frame_remainder_mismatch
+};
+
+// context, where set, names what the error refers to (eg the calling function for oor_port_id). It must point to storage that outlives
+// the error, normally a string literal.
+struct error_state {
+	error_type type = error_type::none;
+	int err_no = 0;
+	const char* context = NULL;
+};
+
+// Identifies one of an agent's Ports by its position in the agent's Port storage, so that it need not be looked up by identifier on every
+// call. The handle with index i refers to the Port named by GetPortIdentifiers()[i].
+struct port_handle {
+	size_t index;
+	
+	bool operator==(port_handle const& rhs) const {
+		return (this->index == rhs.index);
+	}
+	bool operator!=(port_handle const& rhs) const {
+		return (this->index != rhs.index);
+	}
+};
+
+// Identifies one Port of one of a SatTerm_Pool's clients. client is the index of the client within the pool.
+struct pool_port {
+	size_t client;
+	port_handle port;
+	
+	bool operator==(pool_port const& rhs) const {
+		return ((this->client == rhs.client) && (this->port == rhs.port));
+	}
+	bool operator!=(pool_port const& rhs) const {
+		return ((this->client != rhs.client) || (this->port != rhs.port));
+	}
+};
+
+// How a SatTerm_Dispatcher chooses the client for each work item. Clients that have disconnected are never chosen.
+//   round_robin       - Each connected client in turn.
+//   least_outstanding - The client with the fewest work items sent but not yet answered.
+//   least_occupied    - The client with the fewest bytes sent but not yet read from its Port (see GetUnreadBytes()), falling back to
+//                       fewest outstanding when this is equal, as it is whenever every client is keeping up.
+enum class dispatch_policy {
+	round_robin,
+	least_outstanding,
+	least_occupied
+};
+
+// One result collected by a SatTerm_Dispatcher. job is the number Submit() returned for the work item, or 0 for a message the client sent
+// unasked. If the client disconnected before answering, completed is false and result is empty.
+struct dispatch_result {
+	uint64_t job;
+	size_t client;
+	bool completed;
+	std::string result;
+};
+
+// How message boundaries are marked on the wire.
+//   end_char      - Each message is followed by the Port's end char. Messages must not contain the end char.
+//   length_prefix - Each message is preceded by its length as a native-endian uint32_t. Messages may contain any bytes.
+enum class framing_mode {
+	end_char,
+	length_prefix
+};
+
+// How message bytes travel between the two ends of a Port.
+//   fifo          - Through the Port's pair of named pipes.
+//   shared_memory - Through a ring buffer per direction in a shared memory segment. The fifos only carry wake-ups.
+//   seqpacket     - Through one connected SOCK_SEQPACKET Unix domain socket in the abstract namespace. No fifos are created for the
+//                   Port (only for the agent's session handshake).
+enum class transport_mode {
+	fifo,
+	shared_memory,
+	seqpacket
+};
+
+struct port_options {
+	framing_mode framing = framing_mode::end_char;
+	transport_mode transport = transport_mode::fifo;
+	size_t ring_size = 1048576;              // Bytes per direction for transport_mode::shared_memory. Rounded up to a power of two.
+	std::chrono::microseconds ring_spin = std::chrono::microseconds(50);     // How long a blocking receive on a shared memory Port polls
+	                                                                         // the ring before it sleeps. Zero never polls.
+	size_t pipe_size = 0;                    // Requested capacity of both fifos in bytes. Zero keeps the kernel default (64 KiB).
+	bool adaptive_pipe_size = false;         // Double the tx fifo capacity whenever sends keep finding it full.
+	                                         // Both are capped at /proc/sys/fs/pipe-max-size and only apply to fifo transport.
+};
+
+// How the server starts the client process.
+//   terminal_emulator - In a new terminal emulator window, trying each path in the terminal emulator paths file in turn.
+//   headless          - By executing the client binary directly, with no window. Its stdin is /dev/null and its stdout and stderr go to
+//                       output_path.
+enum class launch_mode {
+	terminal_emulator,
+	headless
+};
+
+struct launch_options {
+	launch_mode mode = launch_mode::terminal_emulator;
+	std::string output_path = "/dev/null";   // Headless only. The client's output is appended to this file, created if need be.
+	std::string fifo_directory = "";         // Existing directory in which the Ports' fifos are created (and from which seqpacket socket
+	                                         // names are derived). Empty uses the server's current working directory.
+};
@@ -0,0 +1,193 @@
+// -----------------------------------------------------------------------------------------------------
+// satellite_terminal - Easily spawn and communicate bidirectionally with client processes in separate
+//                      terminal emulator instances.
+// -----------------------------------------------------------------------------------------------------
+// seb.nf.sikora@protonmail.com
+//
+// Copyright © 2021 Dr Seb N.F. Sikora.
+//
+// This work is licensed under the terms of the MIT license.
+// For a copy, see <https://opensource.org/licenses/MIT>.
+// -----------------------------------------------------------------------------------------------------
+
+#include <atomic>                    // std::atomic, std::atomic_thread_fence.
+#include <thread>                    // std::this_thread::yield.
+#include <chrono>                    // std::chrono::steady_clock.
+#include <cstdint>                   // uint32_t.
+
+#include <time.h>                    // struct timespec.
+#include <limits.h>                  // INT_MAX.
+#include <unistd.h>                  // syscall().
+#include <sys/syscall.h>             // SYS_futex.
+#include <linux/futex.h>             // FUTEX_WAIT_PRIVATE, FUTEX_WAKE_PRIVATE.
+
+// Sleeps while word holds expected, until woken by FutexWake() or timeout (NULL for none) elapses. May return spuriously.
+static inline void FutexWait(std::atomic<uint32_t>& word, uint32_t expected, const struct timespec* timeout) {
+	syscall(SYS_futex, (uint32_t*)(&word), FUTEX_WAIT_PRIVATE, expected, timeout, NULL, 0);
+}
+
+static inline void FutexWake(std::atomic<uint32_t>& word) {
+	syscall(SYS_futex, (uint32_t*)(&word), FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+}
+
+// Fair (first come, first served) lock. Waiters sleep rather than spin, as the holder may itself be waiting for a slow reader to drain
+// the fifo.
+class SatTerm_TicketLock {
+	public:
+		void Lock(void) {
+			uint32_t ticket = m_next_ticket.fetch_add(1, std::memory_order_relaxed);
+			uint32_t serving = m_now_serving.load(std::memory_order_acquire);
+			while (serving != ticket) {
+				m_waiters.fetch_add(1, std::memory_order_seq_cst);
+				serving = m_now_serving.load(std::memory_order_seq_cst);
+				if (serving != ticket) {
+					FutexWait(m_now_serving, serving, NULL);
+				}
+				m_waiters.fetch_sub(1, std::memory_order_relaxed);
+				serving = m_now_serving.load(std::memory_order_acquire);
+			}
+		}
+		
+		void Unlock(void) {
+			m_now_serving.fetch_add(1, std::memory_order_seq_cst);
+			if (m_waiters.load(std::memory_order_seq_cst) > 0) {
+				FutexWake(m_now_serving);
+			}
+		}
+	
+	private:
+		std::atomic<uint32_t> m_next_ticket = {0};
+		std::atomic<uint32_t> m_now_serving = {0};
+		std::atomic<uint32_t> m_waiters = {0};
+};
+
+// Orders concurrent sends on one Port. Frames small enough to be written atomically are sent lock-free by "shared" writers, while a send
+// that may write its frame in several pieces takes the ticket lock and excludes the shared writers until the frame is complete.
+class SatTerm_SendSequencer {
+	public:
+		bool TryEnterShared(void) {
+			m_shared_writers.fetch_add(1, std::memory_order_seq_cst);
+			if (m_exclusive.load(std::memory_order_seq_cst) != OPEN) {
+				m_shared_writers.fetch_sub(1, std::memory_order_release);
+				return false;
+			}
+			return true;
+		}
+		
+		void LeaveShared(void) {
+			m_shared_writers.fetch_sub(1, std::memory_order_release);
+		}
+		
+		// Sleeps while a Lock() holder is sending. Returns true once shared writers may enter again, or false if deadline passed first or
+		// a frame has been left part-sent, in which case only Lock() holders may send until one of them finishes it.
+		bool WaitForShared(std::chrono::steady_clock::time_point deadline) {
+			while (true) {
+				uint32_t state = m_exclusive.load(std::memory_order_acquire);
+				if ((state == OPEN) || (state == FRAME_OPEN)) {
+					return (state == OPEN);
+				}
+				std::chrono::steady_clock::duration wait_time = deadline - std::chrono::steady_clock::now();
+				if (wait_time <= std::chrono::steady_clock::duration::zero()) {
+					return false;
+				}
+				if (wait_time > std::chrono::milliseconds(100)) {
+					wait_time = std::chrono::milliseconds(100);
+				}
+				struct timespec wait_timespec = {0, (long)(std::chrono::duration_cast<std::chrono::nanoseconds>(wait_time).count())};
+				m_waiters.fetch_add(1, std::memory_order_seq_cst);
+				if (m_exclusive.load(std::memory_order_seq_cst) == LOCKED) {
+					FutexWait(m_exclusive, LOCKED, &wait_timespec);
+				}
+				m_waiters.fetch_sub(1, std::memory_order_relaxed);
+			}
+		}
+		
+		bool IsLocked(void) {
+			return (m_exclusive.load(std::memory_order_acquire) == LOCKED);
+		}
+		
+		void Lock(void) {
+			m_lock.Lock();
+			m_exclusive.store(LOCKED, std::memory_order_seq_cst);
+			while (m_shared_writers.load(std::memory_order_acquire) != 0) {     // Each is at most one non-blocking write() from leaving.
+				std::this_thread::yield();
+			}
+		}
+		
+		void Unlock(bool frame_open) {
+			m_exclusive.store(frame_open ? FRAME_OPEN : OPEN, std::memory_order_seq_cst);
+			if (m_waiters.load(std::memory_order_seq_cst) > 0) {
+				FutexWake(m_exclusive);
+			}
+			m_lock.Unlock();
+		}
+	
+	private:
+		static const uint32_t OPEN = 0;
+		static const uint32_t LOCKED = 1;
+		static const uint32_t FRAME_OPEN = 2;
+		
+		SatTerm_TicketLock m_lock;
+		std::atomic<uint32_t> m_exclusive = {OPEN};
+		std::atomic<uint32_t> m_shared_writers = {0};
+		std::atomic<uint32_t> m_waiters = {0};                   // Threads asleep in WaitForShared().
+};
+
+// error_state that several threads may read and write at once, as concurrent senders all report through the same agent and Port.
+// A write that would not change the state is skipped, so threads whose sends succeed only ever read it and never contend for it.
+class SatTerm_ErrorCell {
+	public:
+		SatTerm_ErrorCell() {}
+		SatTerm_ErrorCell(SatTerm_ErrorCell const&) = delete;
+		SatTerm_ErrorCell& operator=(SatTerm_ErrorCell const&) = delete;
+		
+		SatTerm_ErrorCell& operator=(error_state const& error) {
+			Set(error);
+			return *this;
+		}
+		
+		operator error_state() const {
+			return Get();
+		}
+		
+		error_state Get(void) const {
+			while (true) {
+				uint32_t sequence = m_sequence.load(std::memory_order_acquire);
+				if ((sequence & 1) == 0) {
+					error_state error = {m_type.load(std::memory_order_relaxed), m_err_no.load(std::memory_order_relaxed),
+					                     m_context.load(std::memory_order_relaxed)};
+					std::atomic_thread_fence(std::memory_order_acquire);
+					if (m_sequence.load(std::memory_order_relaxed) == sequence) {
+						return error;
+					}
+				}
+				std::this_thread::yield();
+			}
+		}
+		
+		void Set(error_state const& error) {
+			error_state current = Get();
+			if ((current.type == error.type) && (current.err_no == error.err_no) && (current.context == error.context)) {
+				return;
+			}
+			uint32_t sequence = m_sequence.load(std::memory_order_relaxed);
+			while (((sequence & 1) != 0) || !m_sequence.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire,
+			                                                                   std::memory_order_relaxed)) {
+				if ((sequence & 1) != 0) {          // Another writer is part-way through.
+					std::this_thread::yield();
+					sequence = m_sequence.load(std::memory_order_relaxed);
+				}
+			}
+			std::atomic_thread_fence(std::memory_order_release);
+			m_type.store(error.type, std::memory_order_relaxed);
+			m_err_no.store(error.err_no, std::memory_order_relaxed);
+			m_context.store(error.context, std::memory_order_relaxed);
+			m_sequence.store(sequence + 2, std::memory_order_release);
+		}
+	
+	private:
+		std::atomic<uint32_t> m_sequence = {0};                  // Odd while a write is in progress.
+		std::atomic<error_type> m_type = {error_type::none};
+		std::atomic<int> m_err_no = {0};
+		std::atomic<const char*> m_context = {NULL};
+};